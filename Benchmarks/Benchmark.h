@@ -0,0 +1,47 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <chrono>
+#include <cstdio>
+
+// Minimal timing helpers shared by the benchmarks. Each benchmark times a
+// baseline (the code path it replaced) against the current one.
+namespace Benchmark
+{
+    // Fastest of several runs in milliseconds. The fastest run is the one
+    // least disturbed by the rest of the system.
+    template <typename Function>
+    double bestOf (int runs, Function&& function)
+    {
+        double best = 0.0;
+
+        for (int run = 0; run < runs; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+            if (run == 0 || elapsed.count() < best)
+                best = elapsed.count();
+        }
+
+        return best;
+    }
+
+    inline void report (const char* name, double baselineMs, double currentMs)
+    {
+        std::printf ("  %-42s %10.3f ms %10.3f ms %8.2fx\n", name, baselineMs, currentMs,
+                     currentMs > 0.0 ? baselineMs / currentMs : 0.0);
+    }
+
+    inline void header (const juce::String& title)
+    {
+        std::printf ("\n%s\n  %-42s %13s %13s %9s\n", title.toRawUTF8(), "", "baseline", "current", "speed-up");
+    }
+
+    // Stops the optimiser from discarding results that are never read
+    inline volatile double sink = 0.0;
+}
+
+void runMixerBenchmark();
+void runStateBenchmark();
+void runDkitBenchmark();
@@ -0,0 +1,206 @@
+#include "Benchmark.h"
+#include "../Source/DkitParser.h"
+#include "../Source/PresetManager.h"
+
+// Reads a generated library of .dkit presets through the juce::JSON path
+// PresetManager used before DkitParser, through DkitParser, and through the
+// header-only summary the preset index reads.
+namespace
+{
+    constexpr int kNumPresets = 2000;
+    constexpr int kRuns = 3;
+
+    juce::var makePad (int note, bool layered)
+    {
+        juce::DynamicObject::Ptr pad = new juce::DynamicObject();
+        auto folder = "Kit " + juce::String (note % 7) + "/";
+        pad->setProperty ("midiNote", note);
+        pad->setProperty ("sampleFile", folder + "Pad " + juce::String (note) + ".wav");
+        pad->setProperty ("sampleName", "Pad " + juce::String (note));
+
+        if (layered)
+        {
+            juce::Array<juce::var> layers;
+            for (int layer = 0; layer < 3; ++layer)
+            {
+                juce::DynamicObject::Ptr layerObj = new juce::DynamicObject();
+                layerObj->setProperty ("velocityLow", layer * 43 + 1);
+                layerObj->setProperty ("velocityHigh", juce::jmin (127, layer * 43 + 43));
+
+                juce::Array<juce::var> samples;
+                for (int rr = 0; rr < 4; ++rr)
+                    samples.add (folder + "Pad " + juce::String (note) + " V" + juce::String (layer)
+                                 + " RR" + juce::String (rr) + ".wav");
+                layerObj->setProperty ("samples", samples);
+
+                layers.add (juce::var (layerObj.get()));
+            }
+            pad->setProperty ("layers", layers);
+        }
+
+        return juce::var (pad.get());
+    }
+
+    // Same shape as PresetManager::writeDkitJson produces
+    void writeCorpus (const juce::File& dir)
+    {
+        juce::Random random (11);
+
+        for (int i = 0; i < kNumPresets; ++i)
+        {
+            juce::DynamicObject::Ptr root = new juce::DynamicObject();
+            root->setProperty ("formatVersion", 1);
+            root->setProperty ("name", "Preset " + juce::String (i));
+            root->setProperty ("author", "Beatwerk");
+            root->setProperty ("description", "Generated kit number " + juce::String (i) + " for benchmarking");
+            root->setProperty ("source", "Imported from Ableton Live");
+            root->setProperty ("createdAt", "2026-10-16T12:00:00.000Z");
+
+            juce::Array<juce::var> pads;
+            int numPads = 16 + random.nextInt (17);
+            for (int note = 36; note < 36 + numPads; ++note)
+                pads.add (makePad (note, random.nextInt (8) == 0));
+            root->setProperty ("pads", pads);
+
+            dir.getChildFile ("Preset " + juce::String (i) + ".dkit").replaceWithText (juce::JSON::toString (juce::var (root.get())));
+        }
+    }
+
+    // PresetManager::parseDkitJson as it was before DkitParser
+    DkitPreset parseWithJson (const juce::File& file)
+    {
+        DkitPreset preset;
+        preset.sourceFile = file;
+
+        auto parsed = juce::JSON::parse (file.loadFileAsString());
+        if (! parsed.isObject())
+            return preset;
+
+        preset.name = parsed.getProperty ("name", "").toString();
+        preset.author = parsed.getProperty ("author", "").toString();
+        preset.description = parsed.getProperty ("description", "").toString();
+        preset.source = parsed.getProperty ("source", "").toString();
+        preset.createdAt = parsed.getProperty ("createdAt", "").toString();
+
+        auto padsArray = parsed.getProperty ("pads", juce::var());
+        if (padsArray.isArray())
+        {
+            for (int i = 0; i < padsArray.size(); ++i)
+            {
+                auto padVar = padsArray[i];
+                DkitPadMapping mapping;
+                mapping.midiNote = (int) padVar.getProperty ("midiNote", -1);
+                mapping.sampleFile = padVar.getProperty ("sampleFile", "").toString();
+                mapping.sampleName = padVar.getProperty ("sampleName", "").toString();
+                mapping.voices = (int) padVar.getProperty ("voices", 0);
+                mapping.chokeGroup = (int) padVar.getProperty ("chokeGroup", 0);
+
+                auto layersArray = padVar.getProperty ("layers", juce::var());
+                if (layersArray.isArray())
+                {
+                    for (int l = 0; l < layersArray.size(); ++l)
+                    {
+                        auto layerVar = layersArray[l];
+                        DkitSampleLayer layer;
+                        layer.velocityLow = (int) layerVar.getProperty ("velocityLow", 1);
+                        layer.velocityHigh = (int) layerVar.getProperty ("velocityHigh", 127);
+
+                        auto samplesArray = layerVar.getProperty ("samples", juce::var());
+                        if (samplesArray.isArray())
+                            for (int s = 0; s < samplesArray.size(); ++s)
+                                layer.sampleFiles.add (samplesArray[s].toString());
+
+                        if (! layer.sampleFiles.isEmpty())
+                            mapping.layers.push_back (layer);
+                    }
+
+                    if (mapping.sampleFile.isEmpty() && ! mapping.layers.empty())
+                        mapping.sampleFile = mapping.layers.front().sampleFiles[0];
+                }
+                if (mapping.midiNote >= 0)
+                    preset.pads.push_back (mapping);
+            }
+        }
+
+        return preset;
+    }
+
+    bool samePreset (const DkitPreset& a, const DkitPreset& b)
+    {
+        if (a.name != b.name || a.author != b.author || a.description != b.description || a.pads.size() != b.pads.size())
+            return false;
+
+        for (size_t i = 0; i < a.pads.size(); ++i)
+        {
+            auto& padA = a.pads[i];
+            auto& padB = b.pads[i];
+            if (padA.midiNote != padB.midiNote || padA.sampleFile != padB.sampleFile
+                || padA.sampleName != padB.sampleName || padA.layers.size() != padB.layers.size())
+                return false;
+
+            for (size_t l = 0; l < padA.layers.size(); ++l)
+                if (padA.layers[l].velocityLow != padB.layers[l].velocityLow
+                    || padA.layers[l].velocityHigh != padB.layers[l].velocityHigh
+                    || padA.layers[l].sampleFiles != padB.layers[l].sampleFiles)
+                    return false;
+        }
+
+        return true;
+    }
+}
+
+void runDkitBenchmark()
+{
+    auto corpusDir = juce::File::getSpecialLocation (juce::File::tempDirectory)
+                         .getNonexistentChildFile ("BeatwerkDkitBenchmark", {});
+    corpusDir.createDirectory();
+    writeCorpus (corpusDir);
+
+    juce::Array<juce::File> files;
+    for (auto& entry : juce::RangedDirectoryIterator (corpusDir, false, "*.dkit", juce::File::findFiles))
+        files.add (entry.getFile());
+
+    int mismatches = 0;
+    DkitParser checker;
+    for (auto& file : files)
+    {
+        DkitPreset preset;
+        checker.parse (file, preset);
+        mismatches += samePreset (preset, parseWithJson (file)) ? 0 : 1;
+    }
+
+    auto jsonMs = Benchmark::bestOf (kRuns, [&]
+    {
+        for (auto& file : files)
+            Benchmark::sink = (double) parseWithJson (file).pads.size();
+    });
+
+    auto parserMs = Benchmark::bestOf (kRuns, [&]
+    {
+        DkitParser parser;
+        DkitPreset preset;
+        for (auto& file : files)
+        {
+            parser.parse (file, preset);
+            Benchmark::sink = (double) preset.pads.size();
+        }
+    });
+
+    auto summaryMs = Benchmark::bestOf (kRuns, [&]
+    {
+        DkitParser parser;
+        DkitParser::Summary summary;
+        for (auto& file : files)
+        {
+            parser.parseSummary (file, summary);
+            Benchmark::sink = (double) summary.numPads;
+        }
+    });
+
+    corpusDir.deleteRecursively();
+
+    Benchmark::header ("Reading " + juce::String (files.size()) + " .dkit presets");
+    Benchmark::report ("full preset: juce::JSON -> DkitParser", jsonMs, parserMs);
+    Benchmark::report ("index entry: juce::JSON -> summary", jsonMs, summaryMs);
+    std::printf ("  presets parsed differently from juce::JSON: %d\n", mismatches);
+}
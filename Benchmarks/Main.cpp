@@ -0,0 +1,35 @@
+#include "Benchmark.h"
+#include <functional>
+#include <map>
+
+// Runs the benchmarks named on the command line, or all of them
+int main (int argc, char* argv[])
+{
+    const std::map<juce::String, std::function<void()>> benchmarks {
+        { "dkit", runDkitBenchmark },
+        { "mixer", runMixerBenchmark },
+        { "state", runStateBenchmark }
+    };
+
+    juce::StringArray selected;
+    for (int i = 1; i < argc; ++i)
+        selected.add (argv[i]);
+
+    for (auto& name : selected)
+    {
+        if (benchmarks.count (name) == 0)
+        {
+            std::printf ("Unknown benchmark '%s'. Available:", name.toRawUTF8());
+            for (auto& [available, run] : benchmarks)
+                std::printf (" %s", available.toRawUTF8());
+            std::printf ("\n");
+            return 1;
+        }
+    }
+
+    for (auto& [name, run] : benchmarks)
+        if (selected.isEmpty() || selected.contains (name))
+            run();
+
+    return 0;
+}
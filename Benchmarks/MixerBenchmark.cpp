@@ -0,0 +1,104 @@
+#include "Benchmark.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "../Source/VoiceMixer.h"
+
+// Mixes a full voice pool into a stereo block, the way SampleEngine renders,
+// through the AudioBuffer::addFrom calls it used before VoiceMixer and
+// through VoiceMixer::mix.
+namespace
+{
+    constexpr int kBlockSize = 256;
+    constexpr int kNumVoices = 64;
+    constexpr int kNumBlocks = 4000;
+    constexpr int kRuns = 5;
+
+    struct Voice
+    {
+        int numChannels = 1;
+        VoiceMixer::StereoGain from, to;
+    };
+
+    std::vector<Voice> makeVoices (bool ramping)
+    {
+        juce::Random random (42);
+        std::vector<Voice> voices (kNumVoices);
+
+        for (size_t i = 0; i < voices.size(); ++i)
+        {
+            voices[i].numChannels = i % 2 == 0 ? 1 : 2;
+            voices[i].to = VoiceMixer::panGains (random.nextFloat(), random.nextFloat() * 2.0f - 1.0f,
+                                                 voices[i].numChannels > 1);
+            voices[i].from = ramping ? VoiceMixer::StereoGain { voices[i].to.left * 0.5f, voices[i].to.right * 0.5f } : voices[i].to;
+        }
+
+        return voices;
+    }
+
+    double mixWithAddFrom (const std::vector<Voice>& voices, const juce::AudioBuffer<float>& sources,
+                           juce::AudioBuffer<float>& output, bool ramping)
+    {
+        for (int block = 0; block < kNumBlocks; ++block)
+        {
+            output.clear();
+
+            for (size_t v = 0; v < voices.size(); ++v)
+            {
+                auto& voice = voices[v];
+
+                for (int ch = 0; ch < 2; ++ch)
+                {
+                    auto* source = sources.getReadPointer (juce::jmin (ch, voice.numChannels - 1));
+                    float from = ch == 0 ? voice.from.left : voice.from.right;
+                    float to = ch == 0 ? voice.to.left : voice.to.right;
+
+                    if (ramping)
+                        output.addFromWithRamp (ch, 0, source, kBlockSize, from, to);
+                    else
+                        output.addFrom (ch, 0, source, kBlockSize, to);
+                }
+            }
+        }
+
+        return output.getSample (0, kBlockSize / 2);
+    }
+
+    double mixWithVoiceMixer (const std::vector<Voice>& voices, const juce::AudioBuffer<float>& sources,
+                              juce::AudioBuffer<float>& output)
+    {
+        for (int block = 0; block < kNumBlocks; ++block)
+        {
+            output.clear();
+
+            for (auto& voice : voices)
+                VoiceMixer::mix (sources.getArrayOfReadPointers(), voice.numChannels,
+                                 output.getArrayOfWritePointers(), output.getNumChannels(),
+                                 kBlockSize, voice.from, voice.to);
+        }
+
+        return output.getSample (0, kBlockSize / 2);
+    }
+}
+
+void runMixerBenchmark()
+{
+    juce::AudioBuffer<float> sources (2, kBlockSize);
+    juce::Random random (7);
+    for (int ch = 0; ch < sources.getNumChannels(); ++ch)
+        for (int i = 0; i < kBlockSize; ++i)
+            sources.setSample (ch, i, random.nextFloat() * 2.0f - 1.0f);
+
+    juce::AudioBuffer<float> output (2, kBlockSize);
+
+    Benchmark::header (juce::String (kNumVoices) + " voices x " + juce::String (kNumBlocks)
+                       + " blocks of " + juce::String (kBlockSize) + " frames (addFrom vs VoiceMixer)");
+
+    for (bool ramping : { false, true })
+    {
+        auto voices = makeVoices (ramping);
+
+        auto baseline = Benchmark::bestOf (kRuns, [&] { Benchmark::sink = mixWithAddFrom (voices, sources, output, ramping); });
+        auto current = Benchmark::bestOf (kRuns, [&] { Benchmark::sink = mixWithVoiceMixer (voices, sources, output); });
+
+        Benchmark::report (ramping ? "gain ramp" : "steady gain", baseline, current);
+    }
+}
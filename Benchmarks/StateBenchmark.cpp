@@ -0,0 +1,229 @@
+#include "Benchmark.h"
+#include <juce_data_structures/juce_data_structures.h>
+#include "../Source/StateFormat.h"
+#include <functional>
+
+// Saves and restores a 128-pad session the way the processor does, as XML
+// (AudioProcessor::copyXmlToBinary), as the plain ValueTree stream used
+// before StateFormat, and through StateFormat with its path table.
+namespace
+{
+    constexpr int kNumPads = 128;
+    constexpr int kLayeredPads = 32;
+    constexpr int kLayersPerPad = 3;
+    constexpr int kRoundRobin = 4;
+    constexpr int kIterations = 500;
+    constexpr int kRuns = 5;
+
+    struct Pad
+    {
+        int note = 0;
+        juce::File file;
+        std::vector<std::vector<juce::File>> layers;
+    };
+
+    std::vector<Pad> makePads (const juce::File& samplesDir)
+    {
+        std::vector<Pad> pads (kNumPads);
+
+        for (int i = 0; i < kNumPads; ++i)
+        {
+            auto& pad = pads[(size_t) i];
+            auto folder = samplesDir.getChildFile ("Kit " + juce::String (i / 16));
+            pad.note = i;
+            pad.file = folder.getChildFile ("Pad " + juce::String (i) + " Hit.wav");
+
+            if (i < kLayeredPads)
+            {
+                pad.layers.resize (kLayersPerPad);
+                for (int layer = 0; layer < kLayersPerPad; ++layer)
+                    for (int rr = 0; rr < kRoundRobin; ++rr)
+                        pad.layers[(size_t) layer].push_back (folder.getChildFile ("Pad " + juce::String (i) + " V"
+                                                                                   + juce::String (layer) + " RR"
+                                                                                   + juce::String (rr) + ".wav"));
+                pad.file = pad.layers[0][0];
+            }
+        }
+
+        return pads;
+    }
+
+    // fileProperty stores a full path ("file") or a path table index ("path")
+    juce::ValueTree makeState (const std::vector<Pad>& pads, const std::function<juce::var (const juce::File&)>& fileProperty,
+                               const char* fileKey)
+    {
+        juce::ValueTree state ("BeatwerkState");
+        state.setProperty ("samplesPath", "/Users/drummer/Music/Beatwerk/Samples", nullptr);
+        state.setProperty ("presetsPath", "/Users/drummer/Music/Beatwerk/Presets", nullptr);
+        state.setProperty ("navChannel", 10, nullptr);
+        state.setProperty ("drumKit", "millenium_mps_1000", nullptr);
+        state.setProperty ("presetIndex", 42, nullptr);
+
+        juce::ValueTree parameters ("PARAMETERS");
+        for (int note = 0; note < kNumPads; ++note)
+        {
+            parameters.appendChild (juce::ValueTree ("PARAM", { { "id", "volume" + juce::String (note) }, { "value", 1.0 } }), nullptr);
+            parameters.appendChild (juce::ValueTree ("PARAM", { { "id", "pan" + juce::String (note) }, { "value", 0.0 } }), nullptr);
+        }
+        state.appendChild (parameters, nullptr);
+
+        juce::ValueTree padsTree ("PadMappings");
+        for (auto& pad : pads)
+        {
+            juce::ValueTree padTree ("Pad");
+            padTree.setProperty ("note", pad.note, nullptr);
+            padTree.setProperty (fileKey, fileProperty (pad.file), nullptr);
+            padTree.setProperty ("chokeGroup", pad.note % 4, nullptr);
+
+            for (auto& layer : pad.layers)
+            {
+                juce::ValueTree layerTree ("Layer");
+                layerTree.setProperty ("velocityLow", 1, nullptr);
+                layerTree.setProperty ("velocityHigh", 127, nullptr);
+
+                for (auto& file : layer)
+                    layerTree.appendChild (juce::ValueTree ("Sample", { { fileKey, fileProperty (file) } }), nullptr);
+
+                padTree.appendChild (layerTree, nullptr);
+            }
+
+            padsTree.appendChild (padTree, nullptr);
+        }
+        state.appendChild (padsTree, nullptr);
+
+        return state;
+    }
+
+    juce::ValueTree makeFullPathState (const std::vector<Pad>& pads)
+    {
+        // The saves this replaced checked every pad's file on disk first
+        return makeState (pads, [] (const juce::File& file)
+        {
+            Benchmark::sink = Benchmark::sink + (file.existsAsFile() ? 1.0 : 0.0);
+            return juce::var (file.getFullPathName());
+        }, "file");
+    }
+
+    // Same layout as AudioProcessor::copyXmlToBinary and getXmlFromBinary
+    void saveXml (const juce::ValueTree& state, juce::MemoryBlock& dest)
+    {
+        {
+            juce::MemoryOutputStream out (dest, false);
+            out.writeInt (0x21324356);
+            out.writeInt (0);
+            state.createXml()->writeTo (out, juce::XmlElement::TextFormat().singleLine());
+            out.writeByte (0);
+        }
+
+        static_cast<juce::uint32*> (dest.getData())[1] = juce::ByteOrder::swapIfBigEndian ((juce::uint32) dest.getSize() - 9);
+    }
+
+    juce::ValueTree restoreXml (const juce::MemoryBlock& data)
+    {
+        auto length = (int) juce::ByteOrder::littleEndianInt (juce::addBytesToPointer (data.getData(), 4));
+        auto xml = juce::parseXML (juce::String::fromUTF8 (static_cast<const char*> (data.getData()) + 8,
+                                                           juce::jmin ((int) data.getSize() - 8, length)));
+        return xml != nullptr ? juce::ValueTree::fromXml (*xml) : juce::ValueTree();
+    }
+
+    // Resolves every pad and layer file, as setStateInformation does
+    int resolveFiles (const juce::ValueTree& state, const std::function<juce::File (const juce::ValueTree&)>& fileOf)
+    {
+        int numFiles = 0;
+
+        for (auto padTree : state.getChildWithName ("PadMappings"))
+        {
+            numFiles += fileOf (padTree) != juce::File() ? 1 : 0;
+
+            for (auto layerTree : padTree)
+                for (auto sampleTree : layerTree)
+                    numFiles += fileOf (sampleTree) != juce::File() ? 1 : 0;
+        }
+
+        return numFiles;
+    }
+
+    juce::File fullPathOf (const juce::ValueTree& tree)
+    {
+        return juce::File (tree.getProperty ("file").toString());
+    }
+}
+
+void runStateBenchmark()
+{
+    auto samplesDir = juce::File::getSpecialLocation (juce::File::tempDirectory)
+                          .getNonexistentChildFile ("BeatwerkStateBenchmark", {});
+    auto pads = makePads (samplesDir);
+
+    for (auto& pad : pads)
+    {
+        pad.file.create();
+        for (auto& layer : pad.layers)
+            for (auto& file : layer)
+                file.create();
+    }
+
+    juce::MemoryBlock xmlData, streamData, binaryData;
+
+    auto saveXmlMs = Benchmark::bestOf (kRuns, [&]
+    {
+        for (int i = 0; i < kIterations; ++i)
+        {
+            xmlData.reset();
+            saveXml (makeFullPathState (pads), xmlData);
+        }
+    });
+
+    auto saveStreamMs = Benchmark::bestOf (kRuns, [&]
+    {
+        for (int i = 0; i < kIterations; ++i)
+        {
+            streamData.reset();
+            juce::MemoryOutputStream out (streamData, false);
+            makeFullPathState (pads).writeToStream (out);
+        }
+    });
+
+    auto saveBinaryMs = Benchmark::bestOf (kRuns, [&]
+    {
+        for (int i = 0; i < kIterations; ++i)
+        {
+            StateFormat::PathTable paths (samplesDir);
+            auto state = makeState (pads, [&paths] (const juce::File& file) { return juce::var (paths.intern (file)); }, "path");
+            binaryData.reset();
+            StateFormat::write (state, paths, binaryData);
+        }
+    });
+
+    auto restoreXmlMs = Benchmark::bestOf (kRuns, [&]
+    {
+        for (int i = 0; i < kIterations; ++i)
+            Benchmark::sink = resolveFiles (restoreXml (xmlData), fullPathOf);
+    });
+
+    auto restoreStreamMs = Benchmark::bestOf (kRuns, [&]
+    {
+        for (int i = 0; i < kIterations; ++i)
+            Benchmark::sink = resolveFiles (juce::ValueTree::readFromData (streamData.getData(), streamData.getSize()), fullPathOf);
+    });
+
+    auto restoreBinaryMs = Benchmark::bestOf (kRuns, [&]
+    {
+        for (int i = 0; i < kIterations; ++i)
+        {
+            StateFormat::PathTable paths (samplesDir);
+            auto state = StateFormat::read (binaryData.getData(), binaryData.getSize(), paths);
+            Benchmark::sink = resolveFiles (state, [&paths] (const juce::ValueTree& tree) { return paths.resolve (tree.getProperty ("path")); });
+        }
+    });
+
+    samplesDir.deleteRecursively();
+
+    Benchmark::header (juce::String (kIterations) + " saves and restores of a " + juce::String (kNumPads) + "-pad session");
+    Benchmark::report ("save: XML -> StateFormat", saveXmlMs, saveBinaryMs);
+    Benchmark::report ("save: ValueTree stream -> StateFormat", saveStreamMs, saveBinaryMs);
+    Benchmark::report ("restore: XML -> StateFormat", restoreXmlMs, restoreBinaryMs);
+    Benchmark::report ("restore: ValueTree stream -> StateFormat", restoreStreamMs, restoreBinaryMs);
+    std::printf ("  size: XML %d bytes, ValueTree stream %d bytes, StateFormat %d bytes\n",
+                 (int) xmlData.getSize(), (int) streamData.getSize(), (int) binaryData.getSize());
+}
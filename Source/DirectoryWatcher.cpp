@@ -0,0 +1,306 @@
+#include "DirectoryWatcher.h"
+#include <map>
+
+#if JUCE_LINUX
+ #include <sys/inotify.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+DirectoryWatcher::DirectoryWatcher (const juce::String& threadName)
+    : juce::Thread (threadName)
+{
+    startThread (juce::Thread::Priority::low);
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    stopThread (5000);
+}
+
+void DirectoryWatcher::setDirectory (const juce::File& directory)
+{
+    {
+        std::lock_guard<std::mutex> lock (directoryMutex);
+        if (directory == pendingDirectory)
+            return;
+
+        pendingDirectory = directory;
+        directoryChanged.store (true);
+    }
+
+    notify();
+}
+
+void DirectoryWatcher::run()
+{
+    while (! threadShouldExit())
+    {
+        juce::File directory;
+        {
+            std::lock_guard<std::mutex> lock (directoryMutex);
+            directory = pendingDirectory;
+            directoryChanged.store (false);
+        }
+
+        batch.clear();
+
+        if (! directory.isDirectory())
+        {
+            // Waits for setDirectory, or retries in case the folder is created
+            wait (kPollIntervalMs);
+            continue;
+        }
+
+        if (! watchWithInotify (directory))
+            watchByPolling (directory);
+    }
+}
+
+void DirectoryWatcher::addChanges (ChangeList&& changes)
+{
+    if (changes.empty())
+        return;
+
+    auto now = juce::Time::getMillisecondCounter();
+    if (batch.empty())
+        batchStarted = now;
+
+    lastChange = now;
+    batch.insert (batch.end(), std::make_move_iterator (changes.begin()), std::make_move_iterator (changes.end()));
+}
+
+void DirectoryWatcher::flushBatch (bool force)
+{
+    if (batch.empty())
+        return;
+
+    auto now = juce::Time::getMillisecondCounter();
+    if (! force && now - lastChange < (juce::uint32) kSettleMs && now - batchStarted < (juce::uint32) kMaxBatchMs)
+        return;
+
+    juce::MessageManager::callAsync ([safeThis = weakThis, changes = std::move (batch)]
+    {
+        if (safeThis != nullptr && safeThis->onChanges)
+            safeThis->onChanges (changes);
+    });
+
+    batch = {};
+}
+
+void DirectoryWatcher::addContents (const juce::File& directory, ChangeList& changes)
+{
+    for (auto& entry : juce::RangedDirectoryIterator (directory, true, "*",
+                                                      juce::File::findFilesAndDirectories | juce::File::ignoreHiddenFiles))
+        changes.push_back ({ Change::Type::Added, entry.getFile(), {}, entry.isDirectory() });
+}
+
+void DirectoryWatcher::watchByPolling (const juce::File& directory)
+{
+    struct Stat
+    {
+        juce::int64 modificationTime = 0, size = 0;
+        bool isDirectory = false;
+    };
+
+    auto takeSnapshot = [&directory]
+    {
+        std::map<juce::String, Stat> snapshot;
+        for (auto& entry : juce::RangedDirectoryIterator (directory, true, "*",
+                                                          juce::File::findFilesAndDirectories | juce::File::ignoreHiddenFiles))
+            snapshot[entry.getFile().getFullPathName()] = { entry.getModificationTime().toMilliseconds(),
+                                                            entry.getFileSize(), entry.isDirectory() };
+        return snapshot;
+    };
+
+    auto previous = takeSnapshot();
+
+    while (! shouldStopWatching())
+    {
+        wait (kPollIntervalMs);
+        if (shouldStopWatching())
+            break;
+
+        auto current = takeSnapshot();
+        ChangeList changes;
+
+        for (auto& [path, stat] : current)
+        {
+            auto it = previous.find (path);
+            if (it == previous.end())
+                changes.push_back ({ Change::Type::Added, juce::File (path), {}, stat.isDirectory });
+            else if (! stat.isDirectory && (it->second.modificationTime != stat.modificationTime || it->second.size != stat.size))
+                changes.push_back ({ Change::Type::Modified, juce::File (path), {}, false });
+        }
+
+        for (auto& [path, stat] : previous)
+            if (current.find (path) == current.end())
+                changes.push_back ({ Change::Type::Removed, juce::File (path), {}, stat.isDirectory });
+
+        previous = std::move (current);
+        addChanges (std::move (changes));
+        flushBatch (true);
+    }
+}
+
+#if JUCE_LINUX
+bool DirectoryWatcher::watchWithInotify (const juce::File& directory)
+{
+    int fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    constexpr uint32_t watchMask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+    std::map<int, juce::File> watches;
+
+    auto addWatch = [fd, &watches] (const juce::File& dir)
+    {
+        int wd = inotify_add_watch (fd, dir.getFullPathName().toRawUTF8(), watchMask);
+        if (wd < 0)
+            return false;
+
+        watches[wd] = dir;
+        return true;
+    };
+
+    auto addWatchTree = [&addWatch] (const juce::File& dir)
+    {
+        if (! addWatch (dir))
+            return false;
+
+        for (auto& entry : juce::RangedDirectoryIterator (dir, true, "*", juce::File::findDirectories | juce::File::ignoreHiddenFiles))
+            if (! addWatch (entry.getFile()))
+                return false;
+
+        return true;
+    };
+
+    // Out of watches (fs.inotify.max_user_watches): poll instead
+    if (! addWatchTree (directory))
+    {
+        ::close (fd);
+        return false;
+    }
+
+    alignas (inotify_event) char buffer[16384];
+    std::map<uint32_t, Change> movedOut;   // IN_MOVED_FROM waiting for its IN_MOVED_TO, by cookie
+
+    while (! shouldStopWatching())
+    {
+        pollfd descriptor { fd, POLLIN, 0 };
+        ChangeList changes;
+
+        if (::poll (&descriptor, 1, 100) > 0)
+        {
+            for (;;)
+            {
+                auto numBytes = ::read (fd, buffer, sizeof (buffer));
+                if (numBytes <= 0)
+                    break;
+
+                for (auto* p = buffer; p < buffer + numBytes;)
+                {
+                    auto* event = reinterpret_cast<const inotify_event*> (p);
+                    p += sizeof (inotify_event) + event->len;
+
+                    if ((event->mask & IN_Q_OVERFLOW) != 0)
+                    {
+                        changes.push_back ({ Change::Type::Reset, directory, {}, true });
+                        continue;
+                    }
+
+                    if ((event->mask & IN_IGNORED) != 0)
+                    {
+                        watches.erase (event->wd);
+                        continue;
+                    }
+
+                    auto watch = watches.find (event->wd);
+                    if (watch == watches.end() || event->len == 0)
+                        continue;
+
+                    juce::String name (juce::CharPointer_UTF8 (event->name));
+                    if (name.startsWithChar ('.'))
+                        continue;
+
+                    auto file = watch->second.getChildFile (name);
+                    bool isDirectory = (event->mask & IN_ISDIR) != 0;
+
+                    if ((event->mask & IN_MOVED_FROM) != 0)
+                    {
+                        movedOut[event->cookie] = { Change::Type::Removed, file, {}, isDirectory };
+                    }
+                    else if ((event->mask & IN_MOVED_TO) != 0)
+                    {
+                        if (auto from = movedOut.find (event->cookie); from != movedOut.end())
+                        {
+                            // Watches below a renamed folder stay valid, under the new path
+                            if (isDirectory)
+                                for (auto& [wd, dir] : watches)
+                                    if (dir == from->second.file || dir.isAChildOf (from->second.file))
+                                        dir = file.getChildFile (dir.getRelativePathFrom (from->second.file));
+
+                            changes.push_back ({ Change::Type::Renamed, file, from->second.file, isDirectory });
+                            movedOut.erase (from);
+                        }
+                        else
+                        {
+                            changes.push_back ({ Change::Type::Added, file, {}, isDirectory });
+                            if (isDirectory && addWatchTree (file))
+                                addContents (file, changes);
+                        }
+                    }
+                    else if ((event->mask & IN_CREATE) != 0)
+                    {
+                        changes.push_back ({ Change::Type::Added, file, {}, isDirectory });
+                        if (isDirectory && addWatchTree (file))
+                            addContents (file, changes);
+                    }
+                    else if ((event->mask & IN_DELETE) != 0)
+                    {
+                        changes.push_back ({ Change::Type::Removed, file, {}, isDirectory });
+                    }
+                    else if ((event->mask & IN_CLOSE_WRITE) != 0)
+                    {
+                        changes.push_back ({ Change::Type::Modified, file, {}, false });
+                    }
+                }
+            }
+        }
+
+        // Anything moved out of the tree has no IN_MOVED_TO; stop watching it
+        for (auto& [cookie, change] : movedOut)
+        {
+            if (change.isDirectory)
+            {
+                for (auto it = watches.begin(); it != watches.end();)
+                {
+                    if (it->second == change.file || it->second.isAChildOf (change.file))
+                    {
+                        inotify_rm_watch (fd, it->first);
+                        it = watches.erase (it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+            }
+
+            changes.push_back (change);
+        }
+
+        movedOut.clear();
+        addChanges (std::move (changes));
+        flushBatch (false);
+    }
+
+    ::close (fd);
+    return true;
+}
+#else
+bool DirectoryWatcher::watchWithInotify (const juce::File&)
+{
+    return false;
+}
+#endif
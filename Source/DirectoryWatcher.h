@@ -0,0 +1,63 @@
+#pragma once
+#include <juce_events/juce_events.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Watches a directory tree on a background thread and reports files and
+// folders added, removed, modified or renamed, in batches on the message
+// thread. Uses inotify on Linux and polls modification times elsewhere or
+// when inotify is unavailable. A folder that appears is reported together
+// with everything inside it. Hidden files are ignored.
+class DirectoryWatcher : private juce::Thread
+{
+public:
+    struct Change
+    {
+        // Reset: events were lost, the whole tree should be re-read
+        enum class Type { Added, Removed, Modified, Renamed, Reset };
+
+        Type type = Type::Added;
+        juce::File file;
+        juce::File previousFile;   // for Renamed
+        bool isDirectory = false;
+    };
+
+    using ChangeList = std::vector<Change>;
+
+    explicit DirectoryWatcher (const juce::String& threadName);
+    ~DirectoryWatcher() override;
+
+    // Replaces the watched directory; an invalid file stops watching
+    void setDirectory (const juce::File& directory);
+
+    std::function<void (const ChangeList&)> onChanges;
+
+    static constexpr int kPollIntervalMs = 2000;
+
+private:
+    // Changes are held back until the tree has been quiet for a moment, so
+    // a bulk copy arrives as one batch
+    static constexpr int kSettleMs = 250;
+    static constexpr int kMaxBatchMs = 2000;
+
+    std::mutex directoryMutex;
+    juce::File pendingDirectory;
+    std::atomic<bool> directoryChanged { false };
+
+    ChangeList batch;
+    juce::uint32 batchStarted = 0, lastChange = 0;
+
+    void run() override;
+    bool shouldStopWatching() { return threadShouldExit() || directoryChanged.load(); }
+    bool watchWithInotify (const juce::File& directory);
+    void watchByPolling (const juce::File& directory);
+
+    void addChanges (ChangeList&& changes);
+    void flushBatch (bool force);
+    static void addContents (const juce::File& directory, ChangeList& changes);
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (DirectoryWatcher)
+    juce::WeakReference<DirectoryWatcher> weakThis { this };
+};
@@ -0,0 +1,187 @@
+#include "DiskStreamer.h"
+
+namespace
+{
+    constexpr int kChunkFrames = 8192;
+}
+
+DiskStreamer::DiskStreamer (juce::AudioFormatManager& formats)
+    : juce::Thread ("Beatwerk Disk Streamer"), formatManager (formats)
+{
+    startThread (juce::Thread::Priority::high);
+}
+
+DiskStreamer::~DiskStreamer()
+{
+    stopThread (2000);
+}
+
+int DiskStreamer::startStream (const SampleData::Ptr& sample)
+{
+    for (int i = 0; i < kMaxStreams; ++i)
+    {
+        auto& stream = streams[(size_t) i];
+        if (stream.state.load (std::memory_order_acquire) != idle)
+            continue;
+
+        auto head = (juce::int64) sample->buffer.getNumSamples();
+        stream.sample = sample;
+        stream.readFrame.store (head, std::memory_order_relaxed);
+        stream.writeFrame.store (head, std::memory_order_relaxed);
+        stream.state.store (starting, std::memory_order_release);
+        notify();
+        return i;
+    }
+
+    return -1;
+}
+
+int DiskStreamer::readFrames (int streamIndex, juce::int64 firstFrame, int numFrames,
+                              float* const* dest, int numDestChannels)
+{
+    auto& stream = streams[(size_t) streamIndex];
+    int state = stream.state.load (std::memory_order_acquire);
+    auto written = stream.writeFrame.load (std::memory_order_acquire);
+
+    int valid = (state == active) ? (int) juce::jlimit ((juce::int64) 0, (juce::int64) numFrames, written - firstFrame)
+                                  : 0;
+    int channels = juce::jmin (numDestChannels, kMaxChannels);
+    int ringPos = (int) (firstFrame % kRingFrames);
+    int firstPart = juce::jmin (valid, kRingFrames - ringPos);
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        auto* ring = stream.ring.getReadPointer (ch);
+        juce::FloatVectorOperations::copy (dest[ch], ring + ringPos, firstPart);
+        juce::FloatVectorOperations::copy (dest[ch] + firstPart, ring, valid - firstPart);
+        juce::FloatVectorOperations::clear (dest[ch] + valid, numFrames - valid);
+    }
+
+    if (valid < numFrames)
+        underruns.fetch_add (1, std::memory_order_relaxed);
+
+    // Frames from firstFrame on stay in the ring, so a varispeed voice can
+    // re-read the few frames its interpolator needs before its next read
+    auto previousRead = stream.readFrame.exchange (firstFrame, std::memory_order_acq_rel);
+
+    // Wake the read-ahead thread once a chunk's worth of the ring is free
+    if (valid < numFrames || previousRead / kChunkFrames != firstFrame / kChunkFrames)
+        notify();
+
+    return valid;
+}
+
+void DiskStreamer::stopStream (int streamIndex)
+{
+    if (streamIndex >= 0 && streamIndex < kMaxStreams)
+    {
+        streams[(size_t) streamIndex].state.store (stopping, std::memory_order_release);
+        notify();
+    }
+}
+
+void DiskStreamer::run()
+{
+    while (! threadShouldExit())
+    {
+        bool busy = false;
+
+        for (auto& stream : streams)
+            busy = serviceStream (stream) || busy;
+
+        // Nothing to read until a stream starts, stops or frees ring space
+        if (! busy)
+            wait (-1);
+    }
+}
+
+bool DiskStreamer::serviceStream (Stream& stream)
+{
+    int state = stream.state.load (std::memory_order_acquire);
+
+    if (state == stopping)
+    {
+        stream.reader.reset();
+        stream.resampler.reset();
+        stream.sample = nullptr;
+        stream.state.store (idle, std::memory_order_release);
+        return false;
+    }
+
+    if (state == starting)
+    {
+        auto& sample = *stream.sample;
+        stream.reader.reset (formatManager.createReaderFor (sample.file));
+
+        if (sample.engineSampleRate != sample.fileSampleRate)
+            stream.resampler = std::make_unique<Resampler> (sample.engineSampleRate / sample.fileSampleRate,
+                                                            sample.resampleQuality);
+
+        // Losing the race against stopStream leaves the stream stopping
+        int expected = starting;
+        stream.state.compare_exchange_strong (expected, active, std::memory_order_acq_rel);
+        return true;
+    }
+
+    if (state == active)
+        return fillStream (stream);
+
+    return false;
+}
+
+bool DiskStreamer::fillStream (Stream& stream)
+{
+    if (stream.reader == nullptr)
+        return false;
+
+    auto& sample = *stream.sample;
+    auto readPos = stream.readFrame.load (std::memory_order_acquire);
+    auto writePos = stream.writeFrame.load (std::memory_order_relaxed);
+
+    // The audio thread ran ahead of us: skip what it has already missed
+    if (readPos > writePos)
+        writePos = readPos;
+
+    auto space = readPos + kRingFrames - writePos;
+    int numFrames = (int) juce::jmin ((juce::int64) kChunkFrames, space, sample.lengthInFrames - writePos);
+    if (numFrames <= 0)
+        return false;
+
+    int channels = juce::jmin (sample.getNumChannels(), kMaxChannels);
+    stream.chunkScratch.setSize (channels, kChunkFrames, false, false, true);
+
+    if (stream.resampler == nullptr)
+    {
+        stream.reader->read (&stream.chunkScratch, 0, numFrames, writePos, true, true);
+    }
+    else
+    {
+        // Read the source span under this chunk plus the kernel's reach, with
+        // a frame to spare each side for rounding
+        double step = sample.fileSampleRate / sample.engineSampleRate;
+        int radius = stream.resampler->getKernelRadius() + 1;
+        auto srcStart = (juce::int64) ((double) writePos * step) - radius;
+        int srcFrames = (int) ((juce::int64) ((double) (writePos + numFrames - 1) * step) + radius - srcStart) + 1;
+
+        stream.fileScratch.setSize (channels, srcFrames, false, false, true);
+        stream.reader->read (&stream.fileScratch, 0, srcFrames, srcStart, true, true);
+
+        for (int ch = 0; ch < channels; ++ch)
+            stream.resampler->process (stream.fileScratch.getReadPointer (ch), srcFrames, srcStart,
+                                       stream.chunkScratch.getWritePointer (ch), writePos, numFrames);
+    }
+
+    int ringPos = (int) (writePos % kRingFrames);
+    int firstPart = juce::jmin (numFrames, kRingFrames - ringPos);
+
+    for (int ch = 0; ch < channels; ++ch)
+    {
+        auto* src = stream.chunkScratch.getReadPointer (ch);
+        auto* ring = stream.ring.getWritePointer (ch);
+        juce::FloatVectorOperations::copy (ring + ringPos, src, firstPart);
+        juce::FloatVectorOperations::copy (ring, src + firstPart, numFrames - firstPart);
+    }
+
+    stream.writeFrame.store (writePos + numFrames, std::memory_order_release);
+    return true;
+}
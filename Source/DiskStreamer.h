@@ -0,0 +1,56 @@
+#pragma once
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "SampleData.h"
+#include <array>
+#include <atomic>
+#include <memory>
+
+// Streams the tails of long samples from disk. Every playing streamed voice
+// owns one stream: a ring buffer that the read-ahead thread keeps filled
+// ahead of the audio thread's read position.
+class DiskStreamer : private juce::Thread
+{
+public:
+    explicit DiskStreamer (juce::AudioFormatManager& formats);
+    ~DiskStreamer() override;
+
+    // Audio thread. startStream returns -1 when every stream is busy.
+    int startStream (const SampleData::Ptr& sample);
+    int readFrames (int streamIndex, juce::int64 firstFrame, int numFrames,
+                    float* const* dest, int numDestChannels);
+    void stopStream (int streamIndex);
+
+    juce::uint32 getNumUnderruns() const { return underruns.load(); }
+
+    static constexpr int kMaxStreams = 32;
+    static constexpr int kMaxChannels = 2;
+    static constexpr int kRingFrames = 32768;
+
+private:
+    enum StreamState { idle, starting, active, stopping };
+
+    struct Stream
+    {
+        std::atomic<int> state { idle };
+        SampleData::Ptr sample;
+
+        // Frames [readFrame, writeFrame) of the sample are valid in the ring
+        juce::AudioBuffer<float> ring { kMaxChannels, kRingFrames };
+        std::atomic<juce::int64> readFrame { 0 };
+        std::atomic<juce::int64> writeFrame { 0 };
+
+        // Read-ahead thread only
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        std::unique_ptr<Resampler> resampler;
+        juce::AudioBuffer<float> fileScratch;
+        juce::AudioBuffer<float> chunkScratch;
+    };
+
+    juce::AudioFormatManager& formatManager;
+    std::array<Stream, kMaxStreams> streams;
+    std::atomic<juce::uint32> underruns { 0 };
+
+    void run() override;
+    bool serviceStream (Stream& stream);
+    bool fillStream (Stream& stream);
+};
@@ -0,0 +1,568 @@
+#include "DkitParser.h"
+#include "PresetManager.h"
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    constexpr juce::int64 kMaxFileSize = 16 * 1024 * 1024;
+
+    bool readHex4 (const char*& pos, const char* end, juce::juce_wchar& value)
+    {
+        if (end - pos < 4)
+            return false;
+
+        value = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto digit = juce::CharacterFunctions::getHexDigitValue ((juce::juce_wchar) (juce::uint8) *pos++);
+            if (digit < 0)
+                return false;
+
+            value = (value << 4) | (juce::juce_wchar) digit;
+        }
+
+        return true;
+    }
+
+    void appendUTF8 (std::string& dest, juce::juce_wchar c)
+    {
+        if (c < 0x80)
+        {
+            dest += (char) c;
+        }
+        else if (c < 0x800)
+        {
+            dest += (char) (0xc0 | (c >> 6));
+            dest += (char) (0x80 | (c & 0x3f));
+        }
+        else if (c < 0x10000)
+        {
+            dest += (char) (0xe0 | (c >> 12));
+            dest += (char) (0x80 | ((c >> 6) & 0x3f));
+            dest += (char) (0x80 | (c & 0x3f));
+        }
+        else
+        {
+            dest += (char) (0xf0 | (c >> 18));
+            dest += (char) (0x80 | ((c >> 12) & 0x3f));
+            dest += (char) (0x80 | ((c >> 6) & 0x3f));
+            dest += (char) (0x80 | (c & 0x3f));
+        }
+    }
+
+    bool isValidUTF8 (std::string_view text)
+    {
+        return juce::CharPointer_UTF8::isValidString (text.data(), (int) text.size());
+    }
+
+    juce::String makeString (std::string_view text)
+    {
+        if (isValidUTF8 (text))
+            return juce::String (juce::CharPointer_UTF8 (text.data()),
+                                 juce::CharPointer_UTF8 (text.data() + text.size()));
+
+        return juce::String::createStringFromData (text.data(), (int) text.size());
+    }
+}
+
+template <typename Callback>
+bool DkitParser::parseObject (Callback&& onKey)
+{
+    if (! consume ('{'))
+        return false;
+
+    if (consume ('}'))
+        return true;
+
+    do
+    {
+        std::string_view key;
+        if (! readString (key) || ! consume (':') || ! onKey (key))
+            return false;
+    }
+    while (consume (','));
+
+    return consume ('}');
+}
+
+template <typename Callback>
+bool DkitParser::parseArray (Callback&& onElement)
+{
+    if (! consume ('['))
+        return false;
+
+    if (consume (']'))
+        return true;
+
+    do
+    {
+        if (! onElement())
+            return false;
+    }
+    while (consume (','));
+
+    return consume (']');
+}
+
+bool DkitParser::parse (const juce::File& file, DkitPreset& preset)
+{
+    preset = {};
+    preset.sourceFile = file;
+
+    if (! load (file))
+        return false;
+
+    bool ok = isNext ('{') && parseObject ([this, &preset] (std::string_view key)
+    {
+        if (key == "name")          return readString (preset.name, false);
+        if (key == "author")        return readString (preset.author, false);
+        if (key == "description")   return readString (preset.description, false);
+        if (key == "source")        return readString (preset.source, false);
+        if (key == "createdAt")     return readString (preset.createdAt, false);
+
+        if (key == "pads")
+        {
+            preset.pads.clear();
+            if (! isNext ('['))
+                return skipValue();
+
+            return parseArray ([this, &preset]
+            {
+                DkitPadMapping pad;
+                if (! parsePad (pad))
+                    return false;
+
+                if (pad.midiNote >= 0)
+                    preset.pads.push_back (std::move (pad));
+
+                return true;
+            });
+        }
+
+        return skipValue();
+    });
+
+    if (! ok)
+    {
+        preset = {};
+        preset.sourceFile = file;
+    }
+
+    return ok;
+}
+
+bool DkitParser::parseSummary (const juce::File& file, Summary& summary)
+{
+    summary = {};
+
+    if (! load (file))
+        return false;
+
+    bool ok = isNext ('{') && parseObject ([this, &summary] (std::string_view key)
+    {
+        if (key == "name")      return readString (summary.name, false);
+        if (key == "author")    return readString (summary.author, false);
+
+        if (key == "pads")
+        {
+            summary.numPads = 0;
+            summary.samplePaths.clearQuick();
+            if (! isNext ('['))
+                return skipValue();
+
+            return parseArray ([this, &summary] { return parsePadSummary (summary); });
+        }
+
+        return skipValue();
+    });
+
+    if (! ok)
+        summary = {};
+
+    return ok;
+}
+
+bool DkitParser::load (const juce::File& file)
+{
+    pos = end = nullptr;
+
+    juce::FileInputStream in (file);
+    if (! in.openedOk())
+        return false;
+
+    auto size = in.getTotalLength();
+    if (size < 0 || size > kMaxFileSize)
+        return false;
+
+    // Keeps its capacity, so parsing many presets allocates once
+    buffer.resize ((size_t) size);
+    if (size > 0 && in.read (buffer.data(), (int) size) != (int) size)
+        return false;
+
+    pos = buffer.data();
+    end = pos + size;
+
+    if (size >= 3 && std::memcmp (pos, "\xef\xbb\xbf", 3) == 0)
+        pos += 3;
+
+    return true;
+}
+
+bool DkitParser::parsePad (DkitPadMapping& pad)
+{
+    if (! isNext ('{'))
+        return skipValue();
+
+    bool ok = parseObject ([this, &pad] (std::string_view key)
+    {
+        if (key == "midiNote")      return readInt (pad.midiNote);
+        if (key == "sampleFile")    return readString (pad.sampleFile, true);
+        if (key == "sampleName")    return readString (pad.sampleName, true);
+        if (key == "voices")        return readInt (pad.voices);
+        if (key == "chokeGroup")    return readInt (pad.chokeGroup);
+
+        if (key == "layers")
+        {
+            pad.layers.clear();
+            if (! isNext ('['))
+                return skipValue();
+
+            return parseArray ([this, &pad]
+            {
+                DkitSampleLayer layer;
+                if (! parseLayer (layer))
+                    return false;
+
+                if (! layer.sampleFiles.isEmpty())
+                    pad.layers.push_back (std::move (layer));
+
+                return true;
+            });
+        }
+
+        return skipValue();
+    });
+
+    if (ok && pad.sampleFile.isEmpty() && ! pad.layers.empty())
+        pad.sampleFile = pad.layers.front().sampleFiles[0];
+
+    return ok;
+}
+
+bool DkitParser::parseLayer (DkitSampleLayer& layer)
+{
+    if (! isNext ('{'))
+        return skipValue();
+
+    return parseObject ([this, &layer] (std::string_view key)
+    {
+        if (key == "velocityLow")   return readInt (layer.velocityLow);
+        if (key == "velocityHigh")  return readInt (layer.velocityHigh);
+
+        if (key == "samples")
+        {
+            layer.sampleFiles.clearQuick();
+            return readStrings (layer.sampleFiles);
+        }
+
+        return skipValue();
+    });
+}
+
+bool DkitParser::parsePadSummary (Summary& summary)
+{
+    if (! isNext ('{'))
+        return skipValue();
+
+    // midiNote may come after the paths, so they are dropped again if the
+    // pad turns out to be unmapped
+    int midiNote = -1;
+    int firstPath = summary.samplePaths.size();
+
+    bool ok = parseObject ([this, &summary, &midiNote] (std::string_view key)
+    {
+        if (key == "midiNote")
+            return readInt (midiNote);
+
+        if (key == "sampleFile")
+        {
+            juce::String path;
+            if (! readString (path, true))
+                return false;
+
+            summary.samplePaths.add (path);
+            return true;
+        }
+
+        if (key == "layers" && isNext ('['))
+        {
+            return parseArray ([this, &summary]
+            {
+                if (! isNext ('{'))
+                    return skipValue();
+
+                return parseObject ([this, &summary] (std::string_view layerKey)
+                {
+                    return layerKey == "samples" ? readStrings (summary.samplePaths) : skipValue();
+                });
+            });
+        }
+
+        return skipValue();
+    });
+
+    if (midiNote >= 0)
+        ++summary.numPads;
+    else
+        summary.samplePaths.removeRange (firstPath, summary.samplePaths.size() - firstPath);
+
+    return ok;
+}
+
+bool DkitParser::readString (std::string_view& text)
+{
+    if (! consume ('"'))
+        return false;
+
+    auto* start = pos;
+    while (pos < end && *pos != '"' && *pos != '\\')
+        ++pos;
+
+    if (pos == end)
+        return false;
+
+    // Most strings have no escapes and are used in place
+    if (*pos == '"')
+    {
+        text = { start, (size_t) (pos++ - start) };
+        return true;
+    }
+
+    scratch.assign (start, pos);
+
+    while (pos < end)
+    {
+        auto c = *pos++;
+
+        if (c == '"')
+        {
+            text = scratch;
+            return true;
+        }
+
+        if (c != '\\')
+        {
+            scratch += c;
+            continue;
+        }
+
+        if (pos == end)
+            return false;
+
+        switch (auto escaped = *pos++)
+        {
+            case 'b':   scratch += '\b'; break;
+            case 'f':   scratch += '\f'; break;
+            case 'n':   scratch += '\n'; break;
+            case 'r':   scratch += '\r'; break;
+            case 't':   scratch += '\t'; break;
+
+            case 'u':
+            {
+                juce::juce_wchar unit;
+                if (! readHex4 (pos, end, unit))
+                    return false;
+
+                // A high surrogate followed by its low half encodes one character
+                if (unit >= 0xd800 && unit < 0xdc00 && end - pos >= 6 && pos[0] == '\\' && pos[1] == 'u')
+                {
+                    auto* next = pos + 2;
+                    juce::juce_wchar low;
+
+                    if (readHex4 (next, end, low) && low >= 0xdc00 && low < 0xe000)
+                    {
+                        unit = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+                        pos = next;
+                    }
+                }
+
+                appendUTF8 (scratch, unit);
+                break;
+            }
+
+            default:    scratch += escaped; break;
+        }
+    }
+
+    return false;
+}
+
+bool DkitParser::readString (juce::String& dest, bool pooled)
+{
+    if (! isNext ('"'))
+    {
+        dest = {};
+        return skipValue();
+    }
+
+    std::string_view text;
+    if (! readString (text))
+        return false;
+
+    if (! pooled)
+        dest = makeString (text);
+    else if (isValidUTF8 (text))
+        dest = pool.getPooledString (juce::String::CharPointerType (text.data()),
+                                     juce::String::CharPointerType (text.data() + text.size()));
+    else
+        dest = pool.getPooledString (makeString (text));
+
+    return true;
+}
+
+bool DkitParser::readStrings (juce::StringArray& dest)
+{
+    if (! isNext ('['))
+        return skipValue();
+
+    return parseArray ([this, &dest]
+    {
+        juce::String value;
+        if (! readString (value, true))
+            return false;
+
+        dest.add (value);
+        return true;
+    });
+}
+
+bool DkitParser::readInt (int& dest)
+{
+    if (isNext ('"'))
+    {
+        std::string_view text;
+        if (! readString (text))
+            return false;
+
+        dest = makeString (text).getIntValue();
+        return true;
+    }
+
+    if (isNext ('{') || isNext ('['))
+    {
+        dest = 0;
+        return skipValue();
+    }
+
+    auto* start = pos;
+    if (! skipNumberOrLiteral())
+        return false;
+
+    std::string_view token (start, (size_t) (pos - start));
+
+    if (token == "true")
+    {
+        dest = 1;
+        return true;
+    }
+
+    if (token == "false" || token == "null")
+    {
+        dest = 0;
+        return true;
+    }
+
+    bool negative = token.front() == '-';
+    size_t i = negative ? 1 : 0;
+    juce::int64 value = 0;
+
+    for (; i < token.size() && juce::CharacterFunctions::isDigit (token[i]); ++i)
+        value = juce::jmin (value * 10 + (token[i] - '0'), (juce::int64) std::numeric_limits<int>::max());
+
+    // Fractions and exponents are rare enough to go through the slow path
+    if (i < token.size())
+    {
+        auto number = makeString (token).getDoubleValue();
+        dest = (int) juce::jlimit ((double) std::numeric_limits<int>::min(),
+                                   (double) std::numeric_limits<int>::max(), number);
+        return true;
+    }
+
+    dest = (int) (negative ? -value : value);
+    return true;
+}
+
+bool DkitParser::skipValue()
+{
+    skipWhitespace();
+    if (pos == end)
+        return false;
+
+    if (*pos == '"')
+    {
+        std::string_view text;
+        return readString (text);
+    }
+
+    if (*pos != '{' && *pos != '[')
+        return skipNumberOrLiteral();
+
+    // Unknown containers are skipped by counting brackets, without recursion
+    int nesting = 0;
+
+    while (pos < end)
+    {
+        auto c = *pos;
+
+        if (c == '"')
+        {
+            std::string_view text;
+            if (! readString (text))
+                return false;
+
+            continue;
+        }
+
+        ++pos;
+
+        if (c == '{' || c == '[')
+            ++nesting;
+        else if ((c == '}' || c == ']') && --nesting == 0)
+            return true;
+    }
+
+    return false;
+}
+
+bool DkitParser::skipNumberOrLiteral()
+{
+    skipWhitespace();
+    auto* start = pos;
+
+    while (pos < end && std::string_view (",:]} \t\r\n").find (*pos) == std::string_view::npos)
+        ++pos;
+
+    return pos > start;
+}
+
+bool DkitParser::consume (char c)
+{
+    if (! isNext (c))
+        return false;
+
+    ++pos;
+    return true;
+}
+
+bool DkitParser::isNext (char c)
+{
+    skipWhitespace();
+    return pos < end && *pos == c;
+}
+
+void DkitParser::skipWhitespace()
+{
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n'))
+        ++pos;
+}
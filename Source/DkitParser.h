@@ -0,0 +1,57 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct DkitPreset;
+struct DkitPadMapping;
+struct DkitSampleLayer;
+
+// Single-pass reader for the .dkit schema. Fills DkitPreset straight from
+// the file bytes without building a juce::var tree, and shares storage for
+// sample paths that repeat across pads, layers and presets read by the
+// same parser. Keys it doesn't know are skipped.
+class DkitParser
+{
+public:
+    // What the preset index needs, read without building pads
+    struct Summary
+    {
+        juce::String name;
+        juce::String author;
+        int numPads = 0;
+        juce::StringArray samplePaths;   // as stored, relative to samplesDir
+    };
+
+    // Both return false if the file can't be read or isn't a .dkit object
+    bool parse (const juce::File& file, DkitPreset& preset);
+    bool parseSummary (const juce::File& file, Summary& summary);
+
+private:
+    std::vector<char> buffer;
+    std::string scratch;
+    juce::StringPool pool;
+
+    const char* pos = nullptr;
+    const char* end = nullptr;
+
+    bool load (const juce::File& file);
+
+    bool parsePad (DkitPadMapping& pad);
+    bool parseLayer (DkitSampleLayer& layer);
+    bool parsePadSummary (Summary& summary);
+
+    template <typename Callback> bool parseObject (Callback&& onKey);
+    template <typename Callback> bool parseArray (Callback&& onElement);
+
+    bool readString (std::string_view& text);
+    bool readString (juce::String& dest, bool pooled);
+    bool readStrings (juce::StringArray& dest);
+    bool readInt (int& dest);
+    bool skipValue();
+    bool skipNumberOrLiteral();
+    bool consume (char c);
+    bool isNext (char c);
+    void skipWhitespace();
+};
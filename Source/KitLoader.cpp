@@ -0,0 +1,202 @@
+#include "KitLoader.h"
+
+KitLoader::KitLoader (SampleEngine& engine)
+    : sampleEngine (engine),
+      threadPool (juce::jlimit (1, 4, juce::SystemStats::getNumCpus() - 1))
+{
+}
+
+KitLoader::~KitLoader()
+{
+    // Jobs capture this, so every one of them has to be gone before the
+    // members are. Bumping the generation makes the queued ones return at once.
+    ++generation;
+    threadPool.removeAllJobs (true, -1);
+}
+
+void KitLoader::loadKit (KitRequest request)
+{
+    auto kit = std::make_shared<PendingKit>();
+    kit->mode = publishMode.load();
+    kit->request = std::move (request);
+
+    auto numPads = kit->request.pads.size();
+    kit->results.resize (numPads);
+    kit->decoded.resize (numPads);
+    kit->filesLeftPerPad = std::make_unique<std::atomic<int>[]> (numPads);
+
+    for (size_t p = 0; p < numPads; ++p)
+    {
+        auto& pad = kit->request.pads[p];
+        if (pad.layers.empty())
+            pad.layers.push_back ({ 1, 127, { pad.file } });
+
+        kit->decoded[p].resize (pad.layers.size());
+        for (size_t l = 0; l < pad.layers.size(); ++l)
+        {
+            kit->decoded[p][l].resize (pad.layers[l].files.size());
+            for (size_t s = 0; s < pad.layers[l].files.size(); ++s)
+                kit->files.push_back ({ p, l, s, pad.layers[l].files[s] });
+        }
+    }
+
+    for (auto& job : kit->files)
+        ++kit->filesLeftPerPad[job.pad];
+
+    {
+        std::lock_guard<std::mutex> lock (publishMutex);
+
+        if (loading.load() && inFlight != nullptr && inFlight->mode == kit->mode && inFlight->request == kit->request)
+            return;
+
+        kit->generation = ++generation;
+        threadPool.removeAllJobs (false, 0);
+        loading.store (true);
+        inFlight = kit;
+
+        if (kit->mode == PublishMode::PerPad)
+        {
+            sampleEngine.publishKit ({});
+            applyPadSettings (kit->request);
+        }
+    }
+
+    // Pads without files only need their missing marker
+    for (size_t p = 0; p < numPads; ++p)
+        if (kit->filesLeftPerPad[p].load() == 0)
+            finishPad (*kit, p);
+
+    if (numPads == 0)
+    {
+        finishKit (*kit);
+        return;
+    }
+
+    for (size_t i = 0; i < kit->files.size(); ++i)
+        threadPool.addJob ([this, kit, i] { runFileJob (kit, i); });
+}
+
+void KitLoader::cancel()
+{
+    std::lock_guard<std::mutex> lock (publishMutex);
+    ++generation;
+    threadPool.removeAllJobs (false, 0);
+    loading.store (false);
+    inFlight.reset();
+}
+
+void KitLoader::runFileJob (const std::shared_ptr<PendingKit>& kit, size_t jobIndex)
+{
+    auto* poolJob = juce::ThreadPoolJob::getCurrentThreadPoolJob();
+    if (kit->generation != generation.load() || (poolJob != nullptr && poolJob->shouldExit()))
+        return;
+
+    // The one disk check per file and kit load; cache lookups never stat
+    auto& job = kit->files[jobIndex];
+    if (sampleEngine.getSampleCache().validate (job.file))
+        kit->decoded[job.pad][job.layer][job.sample] = sampleEngine.decodeSample (job.file);
+
+    if (--kit->filesLeftPerPad[job.pad] == 0)
+        finishPad (*kit, job.pad);
+}
+
+void KitLoader::finishPad (PendingKit& kit, size_t padIndex)
+{
+    auto& pad = kit.request.pads[padIndex];
+    auto& decoded = kit.decoded[padIndex];
+
+    SampleEngine::PadSample result;
+    result.midiNote = pad.midiNote;
+
+    for (size_t l = 0; l < pad.layers.size(); ++l)
+    {
+        SampleEngine::SampleLayer layer;
+        layer.velocityLow = pad.layers[l].velocityLow;
+        layer.velocityHigh = pad.layers[l].velocityHigh;
+
+        for (auto& sample : decoded[l])
+            if (sample != nullptr)
+                layer.roundRobin.push_back (sample);
+
+        if (! layer.roundRobin.empty())
+        {
+            if (result.sample == nullptr)
+                result.sample = layer.roundRobin.front();
+            result.layers.push_back (std::move (layer));
+        }
+    }
+
+    if (result.sample == nullptr && pad.missingName.isNotEmpty())
+        result.sample = sampleEngine.createMissingSample (pad.missingName);
+
+    kit.results[padIndex] = result;
+
+    {
+        std::lock_guard<std::mutex> lock (publishMutex);
+        if (kit.generation != generation.load())
+            return;
+
+        if (kit.mode == PublishMode::PerPad && result.sample != nullptr)
+            sampleEngine.publishPad (result);
+    }
+
+    int done = ++kit.padsDone;
+    int total = (int) kit.request.pads.size();
+    int midiNote = pad.midiNote;
+
+    juce::MessageManager::callAsync ([safeThis = weakThis, midiNote, done, total]
+    {
+        if (safeThis != nullptr && safeThis->onPadLoaded)
+            safeThis->onPadLoaded (midiNote, done, total);
+    });
+
+    if (done == total)
+        finishKit (kit);
+}
+
+void KitLoader::finishKit (PendingKit& kit)
+{
+    {
+        std::lock_guard<std::mutex> lock (publishMutex);
+        if (kit.generation != generation.load())
+            return;
+
+        if (kit.mode == PublishMode::WholeKit)
+        {
+            std::vector<SampleEngine::PadSample> pads;
+            for (auto& result : kit.results)
+                if (result.sample != nullptr)
+                    pads.push_back (result);
+
+            sampleEngine.publishKit (pads);
+            applyPadSettings (kit.request);
+        }
+
+        loading.store (false);
+        inFlight.reset();
+    }
+
+    juce::MessageManager::callAsync ([safeThis = weakThis]
+    {
+        if (safeThis != nullptr && safeThis->onKitLoaded)
+            safeThis->onKitLoaded();
+    });
+}
+
+void KitLoader::applyPadSettings (const KitRequest& request)
+{
+    for (auto& [note, vol] : request.volumes)
+        sampleEngine.setPadVolume (note, vol);
+
+    for (auto& [note, numVoices] : request.polyphony)
+        sampleEngine.setPadPolyphony (note, numVoices);
+
+    for (auto& [note, group] : request.chokeGroups)
+        sampleEngine.setPadChokeGroup (note, group);
+
+    for (auto& [note, sound] : request.sounds)
+        sampleEngine.setPadSound (note, sound);
+
+    for (auto& [note, output] : request.outputs)
+        sampleEngine.setPadOutput (note, output);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <juce_events/juce_events.h>
+#include "SampleEngine.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class KitLoader
+{
+public:
+    enum class PublishMode { WholeKit, PerPad };
+
+    struct LayerRequest
+    {
+        int velocityLow = 1;
+        int velocityHigh = 127;
+        std::vector<juce::File> files;   // round-robin
+
+        bool operator== (const LayerRequest&) const = default;
+    };
+
+    struct PadRequest
+    {
+        int midiNote = -1;
+        juce::File file;
+        juce::String missingName;   // marks the pad missing when no file exists
+        std::vector<LayerRequest> layers;   // replaces file when not empty
+
+        bool operator== (const PadRequest&) const = default;
+    };
+
+    struct KitRequest
+    {
+        std::vector<PadRequest> pads;
+        std::map<int, float> volumes;
+        std::map<int, int> polyphony;
+        std::map<int, int> chokeGroups;
+        std::map<int, SampleEngine::PadSound> sounds;
+        std::map<int, int> outputs;
+
+        bool operator== (const KitRequest&) const = default;
+    };
+
+    explicit KitLoader (SampleEngine& engine);
+    ~KitLoader();
+
+    // Decodes all pads on the loader pool. Any kit still in flight is
+    // cancelled, unless it is the same request, which is left to finish.
+    void loadKit (KitRequest request);
+    void cancel();
+    bool isLoading() const { return loading.load(); }
+
+    void setPublishMode (PublishMode mode) { publishMode.store (mode); }
+    PublishMode getPublishMode() const { return publishMode.load(); }
+
+    // Called on the message thread
+    std::function<void (int midiNote, int padsDone, int padsTotal)> onPadLoaded;
+    std::function<void()> onKitLoaded;
+
+private:
+    // Every file of every layer is decoded by its own job; a pad is
+    // published once its last file is done.
+    struct FileJob
+    {
+        size_t pad = 0, layer = 0, sample = 0;
+        juce::File file;
+    };
+
+    struct PendingKit
+    {
+        int generation = 0;
+        PublishMode mode = PublishMode::WholeKit;
+        KitRequest request;
+        std::vector<FileJob> files;
+        std::vector<std::vector<std::vector<SampleEngine::SampleData::Ptr>>> decoded;   // [pad][layer][sample]
+        std::unique_ptr<std::atomic<int>[]> filesLeftPerPad;
+        std::vector<SampleEngine::PadSample> results;
+        std::atomic<int> padsDone { 0 };
+    };
+
+    SampleEngine& sampleEngine;
+    juce::ThreadPool threadPool;
+    std::atomic<PublishMode> publishMode { PublishMode::WholeKit };
+    std::atomic<int> generation { 0 };
+    std::atomic<bool> loading { false };
+    std::shared_ptr<PendingKit> inFlight;   // guarded by publishMutex
+    std::mutex publishMutex;
+
+    void runFileJob (const std::shared_ptr<PendingKit>& kit, size_t jobIndex);
+    void finishPad (PendingKit& kit, size_t padIndex);
+    void finishKit (PendingKit& kit);
+    void applyPadSettings (const KitRequest& request);
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (KitLoader)
+    juce::WeakReference<KitLoader> weakThis { this };
+};
@@ -3,68 +3,198 @@
 
 MidiMapper::MidiMapper()
 {
-    activeKit = &DrumKitLibrary::getDefaultKit();
+    selectKit (DrumKitLibrary::getDefaultKit());
+    rebuildControllerActions();
 }
 
 void MidiMapper::setActiveKit (const juce::String& kitId)
 {
     auto* kit = DrumKitLibrary::findKit (kitId);
     if (kit != nullptr)
-        activeKit = kit;
+        selectKit (*kit);
+}
+
+void MidiMapper::selectKit (const DrumKitDefinition& kit)
+{
+    for (auto& table : kitTables)
+    {
+        if (table->kit == &kit)
+        {
+            liveTable.store (table.get());
+            return;
+        }
+    }
+
+    auto table = std::make_unique<KitTable>();
+    table->kit = &kit;
+
+    for (auto& p : kit.pads)
+        if (juce::isPositiveAndBelow (p.midiNote, 128) && table->padForNote[(size_t) p.midiNote] == nullptr)
+            table->padForNote[(size_t) p.midiNote] = &p;
+
+    liveTable.store (table.get());
+    kitTables.push_back (std::move (table));
 }
 
 juce::String MidiMapper::getActiveKitId() const
 {
-    if (activeKit != nullptr)
-        return activeKit->id;
-    return {};
+    return getActiveKit()->id;
 }
 
 const std::vector<PadInfo>& MidiMapper::getAllPads() const
 {
-    jassert (activeKit != nullptr);
-    return activeKit->pads;
+    return getActiveKit()->pads;
+}
+
+std::map<int, int> MidiMapper::getDefaultChokeGroups() const
+{
+    std::map<int, int> groups;
+    for (auto& p : getActiveKit()->pads)
+    {
+        juce::String name (p.padName);
+        if (name.startsWith ("Hi-Hat") || name.startsWith ("HH"))
+            groups[p.midiNote] = 1;
+    }
+    return groups;
 }
 
 bool MidiMapper::isPadNote (int midiNote) const
 {
-    for (auto& p : activeKit->pads)
-        if (p.midiNote == midiNote)
-            return true;
-    return false;
+    return getPadInfo (midiNote) != nullptr;
+}
+
+const PadInfo* MidiMapper::getPadInfo (int channel, int midiNote) const
+{
+    if (! juce::isPositiveAndBelow (channel - 1, 16) || (padChannels.load() & (1 << (channel - 1))) == 0)
+        return nullptr;
+
+    return getPadInfo (midiNote);
 }
 
 const PadInfo* MidiMapper::getPadInfo (int midiNote) const
 {
-    for (auto& p : activeKit->pads)
-        if (p.midiNote == midiNote)
-            return &p;
-    return nullptr;
+    if (! juce::isPositiveAndBelow (midiNote, 128))
+        return nullptr;
+
+    return liveTable.load()->padForNote[(size_t) midiNote];
 }
 
 void MidiMapper::setNavChannel (int channel)
 {
-    navChannel = channel;
+    navChannel.store (channel);
+    rebuildControllerActions();
 }
 
 void MidiMapper::setPrevCCNumber (int cc)
 {
-    prevCCNumber = cc;
+    prevCCNumber.store (cc);
+    rebuildControllerActions();
 }
 
 void MidiMapper::setNextCCNumber (int cc)
 {
-    nextCCNumber = cc;
+    nextCCNumber.store (cc);
+    rebuildControllerActions();
+}
+
+void MidiMapper::setPadChannels (int channelMask)
+{
+    padChannels.store (channelMask & 0xffff);
+}
+
+void MidiMapper::setProgramChangeChannel (int channel)
+{
+    programChangeChannel.store (juce::jlimit (-1, 16, channel));
+    rebuildControllerActions();
+}
+
+void MidiMapper::setControllerAction (int channel, int cc, ControllerAction action)
+{
+    if (! juce::isPositiveAndBelow (channel - 1, 16) || ! juce::isPositiveAndBelow (cc, 128))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock (assignedActionsMutex);
+        if (action == ControllerAction::None)
+            assignedActions.erase ({ channel, cc });
+        else
+            assignedActions[{ channel, cc }] = action;
+    }
+
+    ++controllerActionsVersion;
+    rebuildControllerActions();
+}
+
+void MidiMapper::setControllerActions (const ControllerActionMap& actions)
+{
+    {
+        std::lock_guard<std::mutex> lock (assignedActionsMutex);
+        assignedActions.clear();
+
+        for (auto& [key, action] : actions)
+            if (juce::isPositiveAndBelow (key.channel - 1, 16) && juce::isPositiveAndBelow (key.cc, 128)
+                && action != ControllerAction::None)
+                assignedActions[key] = action;
+    }
+
+    ++controllerActionsVersion;
+    rebuildControllerActions();
+}
+
+MidiMapper::ControllerActionMap MidiMapper::getControllerActions() const
+{
+    std::lock_guard<std::mutex> lock (assignedActionsMutex);
+    return assignedActions;
+}
+
+void MidiMapper::rebuildControllerActions()
+{
+    int nav = navChannel.load();
+    int program = programChangeChannel.load();
+    int prev = prevCCNumber.load();
+    int next = nextCCNumber.load();
+    auto assigned = getControllerActions();
+
+    for (int channel = 1; channel <= 16; ++channel)
+    {
+        std::array<ControllerAction, 128> actions {};
+
+        // Navigation CCs win over bank select when both use the same number
+        if (program == 0 || program == channel)
+        {
+            actions[0] = ControllerAction::BankMsb;
+            actions[32] = ControllerAction::BankLsb;
+        }
+
+        if (nav == 0 || nav == channel)
+        {
+            if (juce::isPositiveAndBelow (prev, 128))
+                actions[(size_t) prev] = ControllerAction::Previous;
+            if (juce::isPositiveAndBelow (next, 128))
+                actions[(size_t) next] = ControllerAction::Next;
+        }
+
+        for (auto it = assigned.lower_bound ({ channel, 0 }); it != assigned.end() && it->first.channel == channel; ++it)
+            actions[(size_t) it->first.cc] = it->second;
+
+        auto& row = controllerActions[(size_t) channel - 1];
+        for (size_t cc = 0; cc < actions.size(); ++cc)
+            row[cc].store (actions[cc], std::memory_order_relaxed);
+    }
 }
 
 void MidiMapper::startLearn (LearnTarget target)
 {
+    learnedController.store (-1);
     learnTarget.store (static_cast<int> (target));
+    startTimerHz (30);
 }
 
 void MidiMapper::cancelLearn()
 {
     learnTarget.store (0);
+    learnedController.store (-1);
+    stopTimer();
 }
 
 bool MidiMapper::isLearning() const
@@ -90,51 +220,70 @@ bool MidiMapper::processForLearn (const juce::MidiMessage& msg)
     if (value == 0)
         return false;
 
-    int cc = msg.getControllerNumber();
-    auto learned = static_cast<LearnTarget> (target);
+    // Learning ends with the first controller
+    target = learnTarget.exchange (0);
+    if (target != 0)
+        learnedController.store (target * 128 + msg.getControllerNumber());
 
-    if (learned == LearnTarget::Prev)
-        prevCCNumber = cc;
-    else if (learned == LearnTarget::Next)
-        nextCCNumber = cc;
+    return true;
+}
 
-    learnTarget.store (0);
+void MidiMapper::timerCallback()
+{
+    int learned = learnedController.exchange (-1);
+    if (learned < 0)
+        return;
 
-    if (onLearnComplete)
-    {
-        auto callback = onLearnComplete;
-        juce::MessageManager::callAsync ([callback, learned, cc] { callback (learned, cc); });
-    }
+    stopTimer();
 
-    return true;
+    auto target = static_cast<LearnTarget> (learned / 128);
+    int cc = learned % 128;
+
+    if (target == LearnTarget::Prev)
+        setPrevCCNumber (cc);
+    else if (target == LearnTarget::Next)
+        setNextCCNumber (cc);
+
+    if (onLearnComplete)
+        onLearnComplete (target, cc);
 }
 
-MidiMapper::NavAction MidiMapper::processForNavigation (const juce::MidiMessage& msg) const
+MidiMapper::NavCommand MidiMapper::processForNavigation (const juce::MidiMessage& msg)
 {
-    if (! msg.isController())
-        return NavAction::None;
+    int channel = msg.getChannel();
+    if (! juce::isPositiveAndBelow (channel - 1, 16))
+        return {};
 
-    if (navChannel > 0 && msg.getChannel() != navChannel)
-        return NavAction::None;
+    auto& bank = banks[(size_t) channel - 1];
 
-    int cc = msg.getControllerNumber();
-    int value = msg.getControllerValue();
+    if (msg.isProgramChange())
+    {
+        int program = programChangeChannel.load();
+        if (program == 0 || program == channel)
+            return { NavAction::SelectPreset, bank * 128 + msg.getProgramChangeNumber() };
+        return {};
+    }
 
-    if (value == 0)
-        return NavAction::None;
+    if (! msg.isController())
+        return {};
 
-    if (cc == prevCCNumber)
-        return NavAction::Previous;
+    int value = msg.getControllerValue();
 
-    if (cc == nextCCNumber)
-        return NavAction::Next;
+    switch (controllerActions[(size_t) channel - 1][(size_t) msg.getControllerNumber()].load (std::memory_order_relaxed))
+    {
+        case ControllerAction::BankMsb:   bank = value * 128 + bank % 128; return {};
+        case ControllerAction::BankLsb:   bank = (bank / 128) * 128 + value; return {};
+        case ControllerAction::Previous:  return { value > 0 ? NavAction::Previous : NavAction::None };
+        case ControllerAction::Next:      return { value > 0 ? NavAction::Next : NavAction::None };
+        case ControllerAction::None:      break;
+    }
 
-    return NavAction::None;
+    return {};
 }
 
 bool MidiMapper::isDrumTrigger (const juce::MidiMessage& msg) const
 {
     if (! msg.isNoteOn())
         return false;
-    return isPadNote (msg.getNoteNumber());
+    return getPadInfo (msg.getChannel(), msg.getNoteNumber()) != nullptr;
 }
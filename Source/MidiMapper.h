@@ -1,8 +1,13 @@
 #pragma once
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_events/juce_events.h>
+#include <array>
 #include <atomic>
+#include <compare>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -15,16 +20,21 @@ struct PadInfo
 
 struct DrumKitDefinition;
 
-class MidiMapper
+class MidiMapper : private juce::Timer
 {
 public:
     MidiMapper();
 
     bool isPadNote (int midiNote) const;
     const PadInfo* getPadInfo (int midiNote) const;
+    const PadInfo* getPadInfo (int channel, int midiNote) const;
 
     const std::vector<PadInfo>& getAllPads() const;
-    const DrumKitDefinition* getActiveKit() const { return activeKit; }
+
+    // Choke groups for presets that define none: the kit's hi-hat pads
+    // (open, closed, pedal, edge) share group 1.
+    std::map<int, int> getDefaultChokeGroups() const;
+    const DrumKitDefinition* getActiveKit() const { return liveTable.load()->kit; }
 
     void setActiveKit (const juce::String& kitId);
     juce::String getActiveKitId() const;
@@ -33,13 +43,52 @@ public:
     void setNavChannel (int channel);
     void setPrevCCNumber (int cc);
     void setNextCCNumber (int cc);
-    int getNavChannel() const { return navChannel; }
-    int getPrevCCNumber() const { return prevCCNumber; }
-    int getNextCCNumber() const { return nextCCNumber; }
+    int getNavChannel() const { return navChannel.load(); }
+    int getPrevCCNumber() const { return prevCCNumber.load(); }
+    int getNextCCNumber() const { return nextCCNumber.load(); }
+
+    // Channels whose notes trigger pads, bit n for channel n + 1. Drummers
+    // on different channels can share one instance and its samples.
+    void setPadChannels (int channelMask);
+    int getPadChannels() const { return padChannels.load(); }
+
+    // Program changes on this channel select presets directly, offset by
+    // 128 per bank (CC 0 / CC 32). -1 = off, 0 = any channel.
+    void setProgramChangeChannel (int channel);
+    int getProgramChangeChannel() const { return programChangeChannel.load(); }
+
+    // What each (channel, CC) does. The table is rebuilt from the settings
+    // above, then the actions assigned per controller are laid over it.
+    enum class ControllerAction : juce::uint8 { None, Next, Previous, BankMsb, BankLsb };
+
+    struct ControllerKey
+    {
+        int channel = 1;   // 1 - 16
+        int cc = 0;
+
+        auto operator<=> (const ControllerKey&) const = default;
+    };
+
+    using ControllerActionMap = std::map<ControllerKey, ControllerAction>;
 
-    enum class NavAction { None, Next, Previous };
+    // Assigning None removes the controller's own action
+    void setControllerAction (int channel, int cc, ControllerAction action);
+    void setControllerActions (const ControllerActionMap& actions);
+    ControllerActionMap getControllerActions() const;
 
-    NavAction processForNavigation (const juce::MidiMessage& msg) const;
+    // Changes whenever the assigned actions do
+    juce::uint32 getControllerActionsVersion() const { return controllerActionsVersion.load(); }
+
+    enum class NavAction { None, Next, Previous, SelectPreset };
+
+    struct NavCommand
+    {
+        NavAction action = NavAction::None;
+        int presetIndex = -1;   // for SelectPreset
+    };
+
+    // Audio thread only
+    NavCommand processForNavigation (const juce::MidiMessage& msg);
     bool isDrumTrigger (const juce::MidiMessage& msg) const;
 
     // MIDI Learn
@@ -50,16 +99,49 @@ public:
     bool isLearning() const;
     LearnTarget getLearnTarget() const;
 
+    // Audio thread only. Just records the controller; the mapping is changed
+    // and onLearnComplete called on the message thread.
     bool processForLearn (const juce::MidiMessage& msg);
 
     std::function<void (LearnTarget, int)> onLearnComplete;
 
 private:
-    const DrumKitDefinition* activeKit = nullptr;
-
-    int navChannel = 0;
-    int prevCCNumber = 1;
-    int nextCCNumber = 2;
-
+    // Note -> pad lookup for one kit, published to the audio thread by a
+    // single pointer swap. Kit definitions are static, so each kit's table
+    // is built the first time it is selected and kept until the mapper is
+    // destroyed; a reader never sees a table freed under it.
+    struct KitTable
+    {
+        const DrumKitDefinition* kit = nullptr;
+        std::array<const PadInfo*, 128> padForNote {};
+    };
+
+    std::atomic<const KitTable*> liveTable { nullptr };
+    std::vector<std::unique_ptr<KitTable>> kitTables;   // message thread only
+
+    void selectKit (const DrumKitDefinition& kit);
+
+    // Entries are individually atomic so the audio thread can read while one
+    // changes. Only rebuildControllerActions writes them.
+    std::array<std::array<std::atomic<ControllerAction>, 128>, 16> controllerActions;
+    std::array<int, 16> banks {};   // audio thread only
+
+    ControllerActionMap assignedActions;   // guarded by assignedActionsMutex
+    mutable std::mutex assignedActionsMutex;
+    std::atomic<juce::uint32> controllerActionsVersion { 0 };
+
+    void rebuildControllerActions();
+
+    std::atomic<int> navChannel { 0 };
+    std::atomic<int> prevCCNumber { 1 };
+    std::atomic<int> nextCCNumber { 2 };
+    std::atomic<int> padChannels { 0xffff };
+    std::atomic<int> programChangeChannel { -1 };
+
+    // The audio thread stores the learned controller as target * 128 + cc;
+    // the timer picks it up while learning
     std::atomic<int> learnTarget { 0 };
+    std::atomic<int> learnedController { -1 };
+
+    void timerCallback() override;
 };
@@ -1,4 +1,5 @@
 #include "PadComponent.h"
+#include "PadSoundPanel.h"
 
 const juce::String PadComponent::dragSourceId = "MPSPadDrag";
 const juce::String PadComponent::browserDragPrefix = "MPSSampleDrag:";
@@ -14,7 +15,8 @@ PadComponent::PadComponent (const PadInfo& info, SampleEngine& engine)
     volumeSlider.setColour (juce::Slider::trackColourId, DarkLookAndFeel::accent.withAlpha (0.6f));
     volumeSlider.setColour (juce::Slider::thumbColourId, DarkLookAndFeel::accent);
     volumeSlider.setColour (juce::Slider::backgroundColourId, DarkLookAndFeel::bgLight);
-    volumeSlider.onValueChange = [this]
+    // The parameter attachment applies the value; this reports finished edits
+    volumeSlider.onDragEnd = [this]
     {
         if (onVolumeChanged)
             onVolumeChanged (padInfo.midiNote, (float) volumeSlider.getValue());
@@ -112,6 +114,13 @@ void PadComponent::paint (juce::Graphics& g)
         drawLocateIcon (g);
 }
 
+void PadComponent::attachParameters (juce::AudioProcessorValueTreeState& state)
+{
+    parameterState = &state;
+    volumeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment> (
+        state, "volume" + juce::String (padInfo.midiNote), volumeSlider);
+}
+
 void PadComponent::resized()
 {
     auto bounds = getLocalBounds().reduced (4);
@@ -124,13 +133,45 @@ void PadComponent::mouseDown (const juce::MouseEvent& event)
 {
     if (event.mods.isPopupMenu())
     {
+        constexpr int chokeGroupBaseId = 100;
+        int currentGroup = sampleEngine.getPadChokeGroup (padInfo.midiNote);
+
+        juce::PopupMenu chokeMenu;
+        chokeMenu.addItem (chokeGroupBaseId, "None", true, currentGroup == 0);
+        for (int group = 1; group <= SampleEngine::kNumChokeGroups; ++group)
+            chokeMenu.addItem (chokeGroupBaseId + group, "Group " + juce::String (group), true, currentGroup == group);
+
+        constexpr int outputBaseId = 200;
+        int currentOutput = sampleEngine.getPadOutput (padInfo.midiNote);
+
+        juce::PopupMenu outputMenu;
+        outputMenu.addItem (outputBaseId, "Main", true, currentOutput == 0);
+        for (int bus = 1; bus < SampleEngine::kMaxOutputBuses; ++bus)
+            outputMenu.addItem (outputBaseId + bus, "Out " + juce::String (bus + 1), true, currentOutput == bus);
+
         juce::PopupMenu menu;
+        menu.addItem (2, "Pan, Tune & Envelope...", onSoundChanged != nullptr);
+        menu.addSubMenu ("Choke Group", chokeMenu, onChokeGroupChanged != nullptr);
+        menu.addSubMenu ("Output", outputMenu, onOutputChanged != nullptr);
+        menu.addSeparator();
         menu.addItem (1, "Reset Kit to Default", onResetMapping != nullptr);
         menu.showMenuAsync (juce::PopupMenu::Options(),
             [this] (int result)
             {
                 if (result == 1 && onResetMapping)
                     onResetMapping();
+                else if (result == 2 && onSoundChanged)
+                {
+                    auto panel = std::make_unique<PadSoundPanel> (padInfo.midiNote, sampleEngine, parameterState);
+                    panel->onSoundChanged = onSoundChanged;
+                    panel->onEditFinished = onSoundEditFinished;
+                    auto* parent = getTopLevelComponent();
+                    juce::CallOutBox::launchAsynchronously (std::move (panel), parent->getLocalArea (this, getLocalBounds()), parent);
+                }
+                else if (result >= outputBaseId && onOutputChanged)
+                    onOutputChanged (padInfo.midiNote, result - outputBaseId);
+                else if (result >= chokeGroupBaseId && onChokeGroupChanged)
+                    onChokeGroupChanged (padInfo.midiNote, result - chokeGroupBaseId);
             });
         return;
     }
@@ -188,7 +229,7 @@ void PadComponent::mouseUp (const juce::MouseEvent& event)
 
     if (sampleEngine.hasSample (padInfo.midiNote))
     {
-        sampleEngine.noteOn (padInfo.midiNote, 0.7f);
+        sampleEngine.queueNoteOn (padInfo.midiNote, 0.7f);
         triggerFlash (0.7f);
     }
 }
@@ -349,6 +390,7 @@ void PadComponent::updateSampleDisplay()
 {
     sampleName = sampleEngine.getSampleName (padInfo.midiNote);
     sampleMissing = sampleEngine.isSampleMissing (padInfo.midiNote);
+    // Kit loads set the volume parameter quietly, so the attachment misses them
     volumeSlider.setValue (sampleEngine.getPadVolume (padInfo.midiNote), juce::dontSendNotification);
     repaint();
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <juce_gui_extra/juce_gui_extra.h>
+#include <juce_audio_processors/juce_audio_processors.h>
 #include "MidiMapper.h"
 #include "SampleEngine.h"
 #include "LookAndFeel.h"
@@ -36,11 +37,18 @@ public:
 
     int getMidiNote() const { return padInfo.midiNote; }
 
+    // Binds the volume slider to the pad's host parameter
+    void attachParameters (juce::AudioProcessorValueTreeState& state);
+
     std::function<void (int midiNote, const juce::File& file)> onSampleDropped;
     std::function<void (int sourceNote, int targetNote)> onPadSwapped;
     std::function<void()> onResetMapping;
     std::function<void (const juce::File&)> onLocateSample;
     std::function<void (int midiNote, float volume)> onVolumeChanged;
+    std::function<void (int midiNote, int group)> onChokeGroupChanged;
+    std::function<void (int midiNote, const SampleEngine::PadSound& sound)> onSoundChanged;
+    std::function<void (int midiNote)> onSoundEditFinished;
+    std::function<void (int midiNote, int bus)> onOutputChanged;
 
     static const juce::String dragSourceId;
     static const juce::String browserDragPrefix;
@@ -60,6 +68,8 @@ private:
     static constexpr int sliderHeight = 14;
 
     juce::Slider volumeSlider;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> volumeAttachment;
+    juce::AudioProcessorValueTreeState* parameterState = nullptr;
 
     juce::Rectangle<int> getLocateIconBounds() const;
     void drawLocateIcon (juce::Graphics& g) const;
@@ -18,9 +18,10 @@ juce::File PadMappingManager::getMappingFile (const juce::String& presetId) cons
     return getMappingsDir().getChildFile (presetId + ".json");
 }
 
-void PadMappingManager::saveMapping (const juce::String& presetId, const PadMapping& mapping,
-                                     const VolumeMap& volumes)
+void PadMappingManager::saveMapping (const juce::String& presetId, const MappingData& data)
 {
+    std::lock_guard<std::mutex> lock (fileMutex);
+
     auto dir = getMappingsDir();
     dir.createDirectory();
 
@@ -28,16 +29,55 @@ void PadMappingManager::saveMapping (const juce::String& presetId, const PadMapp
     root->setProperty ("presetId", presetId);
 
     juce::Array<juce::var> padsArray;
-    for (auto& [note, sampleFile] : mapping)
+    for (auto& [note, sampleFile] : data.pads)
     {
         juce::DynamicObject::Ptr pad = new juce::DynamicObject();
         pad->setProperty ("midiNote", note);
         pad->setProperty ("samplePath", sampleFile.getFullPathName());
 
-        auto volIt = volumes.find (note);
-        if (volIt != volumes.end() && std::abs (volIt->second - 1.0f) > 0.001f)
+        auto volIt = data.volumes.find (note);
+        if (volIt != data.volumes.end() && std::abs (volIt->second - 1.0f) > 0.001f)
             pad->setProperty ("volume", (double) volIt->second);
 
+        auto chokeIt = data.chokeGroups.find (note);
+        if (chokeIt != data.chokeGroups.end())
+            pad->setProperty ("chokeGroup", chokeIt->second);
+
+        auto outputIt = data.outputs.find (note);
+        if (outputIt != data.outputs.end() && outputIt->second > 0)
+            pad->setProperty ("output", outputIt->second);
+
+        auto soundIt = data.sounds.find (note);
+        if (soundIt != data.sounds.end())
+        {
+            auto& sound = soundIt->second;
+            pad->setProperty ("pan", (double) sound.pan);
+            pad->setProperty ("tune", (double) sound.tune);
+            pad->setProperty ("attack", (double) sound.attackMs);
+            pad->setProperty ("hold", (double) sound.holdMs);
+            pad->setProperty ("decay", (double) sound.decayMs);
+        }
+
+        auto layersIt = data.layers.find (note);
+        if (layersIt != data.layers.end() && ! layersIt->second.empty())
+        {
+            juce::Array<juce::var> layersArray;
+            for (auto& layer : layersIt->second)
+            {
+                juce::DynamicObject::Ptr layerObj = new juce::DynamicObject();
+                layerObj->setProperty ("velocityLow", layer.velocityLow);
+                layerObj->setProperty ("velocityHigh", layer.velocityHigh);
+
+                juce::Array<juce::var> samplesArray;
+                for (auto& file : layer.files)
+                    samplesArray.add (file.getFullPathName());
+                layerObj->setProperty ("samplePaths", samplesArray);
+
+                layersArray.add (juce::var (layerObj.get()));
+            }
+            pad->setProperty ("layers", layersArray);
+        }
+
         padsArray.add (juce::var (pad.get()));
     }
 
@@ -49,6 +89,8 @@ void PadMappingManager::saveMapping (const juce::String& presetId, const PadMapp
 
 std::optional<PadMappingManager::MappingData> PadMappingManager::loadMapping (const juce::String& presetId) const
 {
+    std::lock_guard<std::mutex> lock (fileMutex);
+
     auto file = getMappingFile (presetId);
     if (! file.existsAsFile())
         return std::nullopt;
@@ -78,6 +120,43 @@ std::optional<PadMappingManager::MappingData> PadMappingManager::loadMapping (co
             float vol = (float) (double) padVar.getProperty ("volume", 1.0);
             if (note >= 0 && std::abs (vol - 1.0f) > 0.001f)
                 data.volumes[note] = vol;
+
+            if (note >= 0 && padVar.hasProperty ("chokeGroup"))
+                data.chokeGroups[note] = (int) padVar.getProperty ("chokeGroup", 0);
+
+            if (note >= 0 && padVar.hasProperty ("output"))
+                data.outputs[note] = (int) padVar.getProperty ("output", 0);
+
+            if (note >= 0 && padVar.hasProperty ("tune"))
+            {
+                SoundSettings sound;
+                sound.pan = (float) (double) padVar.getProperty ("pan", 0.0);
+                sound.tune = (float) (double) padVar.getProperty ("tune", 0.0);
+                sound.attackMs = (float) (double) padVar.getProperty ("attack", 0.0);
+                sound.holdMs = (float) (double) padVar.getProperty ("hold", 0.0);
+                sound.decayMs = (float) (double) padVar.getProperty ("decay", 0.0);
+                data.sounds[note] = sound;
+            }
+
+            auto layersArray = padVar.getProperty ("layers", juce::var());
+            if (note >= 0 && layersArray.isArray())
+            {
+                for (int l = 0; l < layersArray.size(); ++l)
+                {
+                    auto layerVar = layersArray[l];
+                    LayerMapping layer;
+                    layer.velocityLow = (int) layerVar.getProperty ("velocityLow", 1);
+                    layer.velocityHigh = (int) layerVar.getProperty ("velocityHigh", 127);
+
+                    auto samplesArray = layerVar.getProperty ("samplePaths", juce::var());
+                    if (samplesArray.isArray())
+                        for (int s = 0; s < samplesArray.size(); ++s)
+                            layer.files.push_back (juce::File (samplesArray[s].toString()));
+
+                    if (! layer.files.empty())
+                        data.layers[note].push_back (std::move (layer));
+                }
+            }
         }
     }
 
@@ -89,10 +168,12 @@ std::optional<PadMappingManager::MappingData> PadMappingManager::loadMapping (co
 
 bool PadMappingManager::hasCustomMapping (const juce::String& presetId) const
 {
+    std::lock_guard<std::mutex> lock (fileMutex);
     return getMappingFile (presetId).existsAsFile();
 }
 
 void PadMappingManager::clearMapping (const juce::String& presetId)
 {
+    std::lock_guard<std::mutex> lock (fileMutex);
     getMappingFile (presetId).deleteFile();
 }
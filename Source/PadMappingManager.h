@@ -1,8 +1,12 @@
 #pragma once
 #include <juce_core/juce_core.h>
 #include <map>
+#include <mutex>
 #include <optional>
+#include <vector>
 
+// Mappings are read on the preset navigator thread as well as the message
+// thread, so every file access is serialised.
 class PadMappingManager
 {
 public:
@@ -10,15 +14,41 @@ public:
 
     using PadMapping = std::map<int, juce::File>;
     using VolumeMap = std::map<int, float>;
+    using ChokeGroupMap = std::map<int, int>;
+    using OutputMap = std::map<int, int>;
+
+    struct LayerMapping
+    {
+        int velocityLow = 1;
+        int velocityHigh = 127;
+        std::vector<juce::File> files;
+    };
+
+    using LayerMap = std::map<int, std::vector<LayerMapping>>;
+
+    // Pan, tuning and envelope, as in SampleEngine::PadSound
+    struct SoundSettings
+    {
+        float pan = 0.0f;
+        float tune = 0.0f;
+        float attackMs = 0.0f;
+        float holdMs = 0.0f;
+        float decayMs = 0.0f;
+    };
+
+    using SoundMap = std::map<int, SoundSettings>;
 
     struct MappingData
     {
         PadMapping pads;
         VolumeMap volumes;
+        ChokeGroupMap chokeGroups;
+        LayerMap layers;
+        SoundMap sounds;
+        OutputMap outputs;
     };
 
-    void saveMapping (const juce::String& presetId, const PadMapping& mapping,
-                      const VolumeMap& volumes = {});
+    void saveMapping (const juce::String& presetId, const MappingData& data);
     std::optional<MappingData> loadMapping (const juce::String& presetId) const;
     bool hasCustomMapping (const juce::String& presetId) const;
     void clearMapping (const juce::String& presetId);
@@ -28,4 +58,6 @@ public:
 private:
     juce::File getMappingsDir() const;
     juce::File getMappingFile (const juce::String& presetId) const;
+
+    mutable std::mutex fileMutex;
 };
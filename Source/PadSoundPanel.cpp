@@ -0,0 +1,92 @@
+#include "PadSoundPanel.h"
+#include "LookAndFeel.h"
+
+PadSoundPanel::PadSoundPanel (int note, SampleEngine& engine, juce::AudioProcessorValueTreeState* parameters)
+    : midiNote (note)
+{
+    const char* names[] = { "Pan", "Tune", "Attack", "Hold", "Decay" };
+    auto sound = engine.getPadSound (midiNote);
+    const float values[] = { sound.pan, sound.tune, sound.attackMs, sound.holdMs, sound.decayMs };
+
+    for (int i = 0; i < numControls; ++i)
+    {
+        labels[(size_t) i].setText (names[i], juce::dontSendNotification);
+        labels[(size_t) i].setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+        addAndMakeVisible (labels[(size_t) i]);
+
+        auto& slider = sliders[(size_t) i];
+        slider.setSliderStyle (juce::Slider::LinearHorizontal);
+        slider.setTextBoxStyle (juce::Slider::TextBoxRight, false, 70, 20);
+        slider.setColour (juce::Slider::trackColourId, DarkLookAndFeel::accent.withAlpha (0.6f));
+        slider.setColour (juce::Slider::thumbColourId, DarkLookAndFeel::accent);
+        slider.setColour (juce::Slider::backgroundColourId, DarkLookAndFeel::bgLight);
+        addAndMakeVisible (slider);
+    }
+
+    sliders[pan].setRange (-1.0, 1.0, 0.01);
+
+    sliders[tune].setRange (-SampleEngine::kMaxTuneSemitones, SampleEngine::kMaxTuneSemitones, 0.01);
+    sliders[tune].setTextValueSuffix (" st");
+
+    for (auto control : { attack, hold, decay })
+    {
+        sliders[control].setRange (0.0, SampleEngine::kMaxEnvelopeMs, 1.0);
+        sliders[control].setSkewFactorFromMidPoint (500.0);
+        sliders[control].setTextValueSuffix (" ms");
+    }
+
+    sliders[decay].textFromValueFunction = [] (double value)
+    {
+        return value <= 0.0 ? juce::String ("Off") : juce::String (juce::roundToInt (value)) + " ms";
+    };
+
+    for (int i = 0; i < numControls; ++i)
+    {
+        sliders[(size_t) i].setValue (values[i], juce::dontSendNotification);
+        sliders[(size_t) i].setDoubleClickReturnValue (true, 0.0);
+        sliders[(size_t) i].onValueChange = [this]
+        {
+            if (onSoundChanged)
+                onSoundChanged (midiNote, getSound());
+        };
+        // Drags, double-click resets and typed values all end here
+        sliders[(size_t) i].onDragEnd = [this]
+        {
+            if (onEditFinished)
+                onEditFinished (midiNote);
+        };
+    }
+
+    if (parameters != nullptr)
+        panAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment> (
+            *parameters, "pan" + juce::String (midiNote), sliders[pan]);
+
+    // After the attachment, which installs the parameter's own text
+    sliders[pan].textFromValueFunction = [] (double value)
+    {
+        int percent = juce::roundToInt (std::abs (value) * 100.0);
+        return percent == 0 ? juce::String ("C") : juce::String (percent) + (value < 0.0 ? " L" : " R");
+    };
+    sliders[pan].updateText();
+
+    setSize (320, numControls * rowHeight + 16);
+}
+
+void PadSoundPanel::resized()
+{
+    auto bounds = getLocalBounds().reduced (8);
+
+    for (int i = 0; i < numControls; ++i)
+    {
+        auto row = bounds.removeFromTop (rowHeight);
+        labels[(size_t) i].setBounds (row.removeFromLeft (60));
+        sliders[(size_t) i].setBounds (row);
+    }
+}
+
+SampleEngine::PadSound PadSoundPanel::getSound() const
+{
+    return { (float) sliders[pan].getValue(), (float) sliders[tune].getValue(),
+             (float) sliders[attack].getValue(), (float) sliders[hold].getValue(),
+             (float) sliders[decay].getValue() };
+}
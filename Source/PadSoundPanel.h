@@ -0,0 +1,34 @@
+#pragma once
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "SampleEngine.h"
+#include <array>
+
+// Pan, tuning and envelope controls for one pad, shown in a call-out box
+// from the pad's context menu
+class PadSoundPanel : public juce::Component
+{
+public:
+    // With parameters, the pan slider follows the pad's pan host parameter
+    PadSoundPanel (int midiNote, SampleEngine& engine, juce::AudioProcessorValueTreeState* parameters);
+
+    void resized() override;
+
+    // Called for every slider movement, then once when the edit is finished
+    std::function<void (int midiNote, const SampleEngine::PadSound& sound)> onSoundChanged;
+    std::function<void (int midiNote)> onEditFinished;
+
+private:
+    enum Control { pan, tune, attack, hold, decay, numControls };
+
+    int midiNote;
+    std::array<juce::Label, numControls> labels;
+    std::array<juce::Slider, numControls> sliders;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> panAttachment;
+
+    SampleEngine::PadSound getSound() const;
+
+    static constexpr int rowHeight = 28;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PadSoundPanel)
+};
@@ -204,6 +204,174 @@ SettingsOverlay::SettingsOverlay (BeatwerkProcessor& proc) : processor (proc)
         safeThis->updateLearnButtonStates();
     };
 
+    programChangeLabel.setText ("Program Change:", juce::dontSendNotification);
+    programChangeLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (programChangeLabel);
+
+    programChangeBox.addItem ("Off", 1);
+    programChangeBox.addItem ("Any", 2);
+    for (int i = 1; i <= 16; ++i)
+        programChangeBox.addItem ("Ch " + juce::String (i), i + 2);
+    programChangeBox.setSelectedId (processor.getMidiMapper().getProgramChangeChannel() + 2, juce::dontSendNotification);
+    programChangeBox.onChange = [this]
+    {
+        processor.getMidiMapper().setProgramChangeChannel (programChangeBox.getSelectedId() - 2);
+    };
+    addAndMakeVisible (programChangeBox);
+
+    padChannelsLabel.setText ("Pad MIDI Channels:", juce::dontSendNotification);
+    padChannelsLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (padChannelsLabel);
+
+    padChannelsButton.onClick = [this] { showPadChannelsMenu(); };
+    addAndMakeVisible (padChannelsButton);
+    updatePadChannelsButton();
+
+    // Kit loading
+    kitLoadModeLabel.setText ("Kit Loading:", juce::dontSendNotification);
+    kitLoadModeLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (kitLoadModeLabel);
+
+    kitLoadModeBox.addItem ("Switch when whole kit is loaded", 1);
+    kitLoadModeBox.addItem ("Switch pad by pad", 2);
+    kitLoadModeBox.setSelectedId (processor.getKitLoader().getPublishMode() == KitLoader::PublishMode::PerPad ? 2 : 1,
+                                  juce::dontSendNotification);
+    kitLoadModeBox.onChange = [this]
+    {
+        processor.getKitLoader().setPublishMode (kitLoadModeBox.getSelectedId() == 2
+                                                     ? KitLoader::PublishMode::PerPad
+                                                     : KitLoader::PublishMode::WholeKit);
+    };
+    addAndMakeVisible (kitLoadModeBox);
+
+    // Sample cache
+    cacheBudgetLabel.setText ("Sample Cache:", juce::dontSendNotification);
+    cacheBudgetLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (cacheBudgetLabel);
+
+    {
+        auto budgetMB = (int) (processor.getSampleEngine().getSampleCache().getMemoryBudget() / (1024 * 1024));
+        const int budgetChoices[] = { 0, 128, 256, 512, 1024, 2048, 4096 };
+        for (int i = 0; i < (int) std::size (budgetChoices); ++i)
+        {
+            auto mb = budgetChoices[i];
+            cacheBudgetBox.addItem (mb == 0 ? juce::String ("Off")
+                                            : (mb >= 1024 ? juce::String (mb / 1024) + " GB"
+                                                          : juce::String (mb) + " MB"), mb + 1);
+            if (mb == budgetMB)
+                cacheBudgetBox.setSelectedId (mb + 1, juce::dontSendNotification);
+        }
+    }
+    cacheBudgetBox.onChange = [this]
+    {
+        auto mb = (juce::int64) (cacheBudgetBox.getSelectedId() - 1);
+        processor.getSampleEngine().getSampleCache().setMemoryBudget (mb * 1024 * 1024);
+        updateCacheStatsLabel();
+    };
+    addAndMakeVisible (cacheBudgetBox);
+
+    cacheStatsLabel.setFont (juce::FontOptions (11.0f));
+    cacheStatsLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (cacheStatsLabel);
+    updateCacheStatsLabel();
+
+    // Preset prefetching
+    prefetchLabel.setText ("Prefetch Presets:", juce::dontSendNotification);
+    prefetchLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (prefetchLabel);
+
+    prefetchDepthBox.addItem ("Off", 1);
+    for (int i = 1; i <= PresetPrefetcher::kMaxDepth; ++i)
+        prefetchDepthBox.addItem (juce::String (i) + " each side", i + 1);
+    prefetchDepthBox.setSelectedId (processor.getPrefetcher().getDepth() + 1, juce::dontSendNotification);
+    prefetchDepthBox.onChange = [this]
+    {
+        processor.getPrefetcher().setDepth (prefetchDepthBox.getSelectedId() - 1);
+    };
+    addAndMakeVisible (prefetchDepthBox);
+
+    prefetchStatsLabel.setFont (juce::FontOptions (11.0f));
+    prefetchStatsLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (prefetchStatsLabel);
+    updatePrefetchStatsLabel();
+
+    // Disk streaming
+    streamingLabel.setText ("Disk Streaming:", juce::dontSendNotification);
+    streamingLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (streamingLabel);
+
+    for (int preloadMs : { 0, 250, 500, 1000 })
+        streamingBox.addItem (preloadMs == 0 ? juce::String ("Off")
+                                             : juce::String (preloadMs) + " ms preload", preloadMs + 1);
+    streamingBox.setSelectedId (processor.getSampleEngine().getStreamingPreloadMs() + 1, juce::dontSendNotification);
+    streamingBox.onChange = [this]
+    {
+        processor.getSampleEngine().setStreamingPreloadMs (streamingBox.getSelectedId() - 1);
+        updateCacheStatsLabel();
+    };
+    addAndMakeVisible (streamingBox);
+
+    // Sample storage
+    storageLabel.setText ("Sample Storage:", juce::dontSendNotification);
+    storageLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (storageLabel);
+
+    storageBox.addItem ("Decode into memory", 1);
+    storageBox.addItem ("Memory-map WAV/AIFF", 2);
+    storageBox.setSelectedId (processor.getSampleEngine().isMemoryMappingEnabled() ? 2 : 1, juce::dontSendNotification);
+    storageBox.onChange = [this]
+    {
+        processor.getSampleEngine().setMemoryMappingEnabled (storageBox.getSelectedId() == 2);
+        updateCacheStatsLabel();
+    };
+    addAndMakeVisible (storageBox);
+
+    // Resampling quality
+    resampleLabel.setText ("Resampling:", juce::dontSendNotification);
+    resampleLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (resampleLabel);
+
+    resampleBox.addItem ("Fast (linear)", 1);
+    resampleBox.addItem ("Medium (16-tap sinc)", 2);
+    resampleBox.addItem ("High (64-tap sinc)", 3);
+    resampleBox.setSelectedId ((int) processor.getSampleEngine().getResampleQuality() + 1, juce::dontSendNotification);
+    resampleBox.onChange = [this]
+    {
+        processor.getSampleEngine().setResampleQuality ((Resampler::Quality) (resampleBox.getSelectedId() - 1));
+        updateCacheStatsLabel();
+    };
+    addAndMakeVisible (resampleBox);
+
+    // Voices
+    maxVoicesLabel.setText ("Max Voices:", juce::dontSendNotification);
+    maxVoicesLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (maxVoicesLabel);
+
+    for (int numVoices : { 16, 32, 64, 128, 256 })
+        maxVoicesBox.addItem (juce::String (numVoices), numVoices);
+    maxVoicesBox.setSelectedId (processor.getSampleEngine().getMaxVoices(), juce::dontSendNotification);
+    maxVoicesBox.onChange = [this]
+    {
+        processor.getSampleEngine().setMaxVoices (maxVoicesBox.getSelectedId());
+    };
+    addAndMakeVisible (maxVoicesBox);
+
+    stealPolicyLabel.setText ("Voice Stealing:", juce::dontSendNotification);
+    stealPolicyLabel.setColour (juce::Label::textColourId, DarkLookAndFeel::textDim);
+    addAndMakeVisible (stealPolicyLabel);
+
+    stealPolicyBox.addItem ("Oldest voice", 1);
+    stealPolicyBox.addItem ("Quietest voice", 2);
+    stealPolicyBox.addItem ("Lowest velocity", 3);
+    stealPolicyBox.setSelectedId ((int) processor.getSampleEngine().getStealPolicy() + 1, juce::dontSendNotification);
+    stealPolicyBox.onChange = [this]
+    {
+        processor.getSampleEngine().setStealPolicy ((SampleEngine::StealPolicy) (stealPolicyBox.getSelectedId() - 1));
+    };
+    addAndMakeVisible (stealPolicyBox);
+
+    startTimerHz (2);
+
     // Save Preset
     savePresetButton.onClick = [this]
     {
@@ -220,14 +388,7 @@ SettingsOverlay::SettingsOverlay (BeatwerkProcessor& proc) : processor (proc)
                 if (result == 1)
                 {
                     auto name = alertWin->getTextEditorContents ("name");
-                    std::map<int, juce::File> mappings;
-                    for (auto& pad : processor.getMidiMapper().getAllPads())
-                    {
-                        auto file = processor.getSampleEngine().getSampleFile (pad.midiNote);
-                        if (file.existsAsFile())
-                            mappings[pad.midiNote] = file;
-                    }
-                    processor.getPresetManager().savePreset (name, mappings);
+                    processor.saveCurrentKitAsPreset (name);
                     processor.getPresetManager().scanForPresets();
                 }
                 delete alertWin;
@@ -282,6 +443,53 @@ SettingsOverlay::~SettingsOverlay()
     processor.getMidiMapper().onLearnComplete = nullptr;
 }
 
+void SettingsOverlay::updatePadChannelsButton()
+{
+    int mask = processor.getMidiMapper().getPadChannels();
+    if (mask == 0xffff)
+    {
+        padChannelsButton.setButtonText ("Any");
+        return;
+    }
+
+    juce::StringArray channels;
+    for (int i = 0; i < 16; ++i)
+        if ((mask & (1 << i)) != 0)
+            channels.add (juce::String (i + 1));
+
+    padChannelsButton.setButtonText (channels.isEmpty() ? juce::String ("None") : "Ch " + channels.joinIntoString (", "));
+}
+
+void SettingsOverlay::showPadChannelsMenu()
+{
+    int mask = processor.getMidiMapper().getPadChannels();
+
+    juce::PopupMenu menu;
+    menu.addItem (1, "Any", true, mask == 0xffff);
+    menu.addSeparator();
+    for (int i = 0; i < 16; ++i)
+        menu.addItem (i + 2, "Ch " + juce::String (i + 1), true, mask != 0xffff && (mask & (1 << i)) != 0);
+
+    menu.showMenuAsync (juce::PopupMenu::Options().withTargetComponent (&padChannelsButton),
+                        [safeThis = juce::Component::SafePointer<SettingsOverlay> (this)] (int result)
+    {
+        if (safeThis == nullptr || result == 0)
+            return;
+
+        // Picking a channel while on Any narrows down to that channel
+        auto& mm = safeThis->processor.getMidiMapper();
+        int current = mm.getPadChannels();
+        int bit = 1 << (result - 2);
+
+        if (result == 1)
+            mm.setPadChannels (0xffff);
+        else
+            mm.setPadChannels (current == 0xffff ? bit : current ^ bit);
+
+        safeThis->updatePadChannelsButton();
+    });
+}
+
 void SettingsOverlay::updateLearnButtonStates()
 {
     auto target = processor.getMidiMapper().getLearnTarget();
@@ -305,6 +513,37 @@ void SettingsOverlay::updateLearnButtonStates()
     }
 }
 
+void SettingsOverlay::timerCallback()
+{
+    updateCacheStatsLabel();
+    updatePrefetchStatsLabel();
+}
+
+void SettingsOverlay::updatePrefetchStatsLabel()
+{
+    auto stats = processor.getPrefetcher().getStats();
+    auto total = stats.hits + stats.misses;
+    auto text = juce::String ((juce::int64) stats.hits) + "/" + juce::String ((juce::int64) total)
+              + " preset loads prefetched";
+    if (total > 0)
+        text += " (" + juce::String (juce::roundToInt (100.0 * (double) stats.hits / (double) total)) + "%)";
+
+    prefetchStatsLabel.setText (text, juce::dontSendNotification);
+}
+
+void SettingsOverlay::updateCacheStatsLabel()
+{
+    auto stats = processor.getSampleEngine().getSampleCache().getStats();
+    cacheStatsLabel.setText (juce::String (stats.numEntries) + " samples, "
+                                 + juce::File::descriptionOfSizeInBytes (stats.bytesUsed)
+                                 + "  |  " + juce::String ((juce::int64) stats.hits) + " hits, "
+                                 + juce::String ((juce::int64) stats.misses) + " misses, "
+                                 + juce::String ((juce::int64) stats.evictions) + " evictions"
+                                 + "  |  " + juce::String ((juce::int64) processor.getSampleEngine().getNumStreamUnderruns())
+                                 + " stream underruns",
+                             juce::dontSendNotification);
+}
+
 void SettingsOverlay::doAbletonImport()
 {
     auto startImport = [this] (const juce::Array<juce::File>& dirs)
@@ -486,29 +725,63 @@ void SettingsOverlay::resized()
 
     area.removeFromTop (10);
 
-    // MIDI settings
-    navChannelLabel.setBounds (area.removeFromTop (22));
-    navChannelBox.setBounds (area.removeFromTop (28).withWidth (200));
-
-    area.removeFromTop (10);
+    // Engine settings in the right-hand column, MIDI settings on the left
+    auto engineColumn = area.removeFromRight (area.getWidth() / 2);
 
-    prevCCLabel.setBounds (area.removeFromTop (22));
+    auto layoutEngineRow = [&engineColumn] (juce::Label& label, juce::ComboBox& box)
     {
-        auto row = area.removeFromTop (28);
-        prevCCBox.setBounds (row.removeFromLeft (200));
-        row.removeFromLeft (8);
-        prevLearnButton.setBounds (row.removeFromLeft (90));
-    }
+        auto row = engineColumn.removeFromTop (28);
+        label.setBounds (row.removeFromLeft (130));
+        box.setBounds (row.withWidth (juce::jmin (row.getWidth(), 240)));
+    };
 
-    area.removeFromTop (10);
+    layoutEngineRow (kitLoadModeLabel, kitLoadModeBox);
+
+    engineColumn.removeFromTop (4);
+    layoutEngineRow (cacheBudgetLabel, cacheBudgetBox);
+    cacheStatsLabel.setBounds (engineColumn.removeFromTop (18));
+
+    engineColumn.removeFromTop (4);
+    layoutEngineRow (prefetchLabel, prefetchDepthBox);
+    prefetchStatsLabel.setBounds (engineColumn.removeFromTop (18));
+
+    engineColumn.removeFromTop (4);
+    layoutEngineRow (streamingLabel, streamingBox);
 
-    nextCCLabel.setBounds (area.removeFromTop (22));
+    engineColumn.removeFromTop (4);
+    layoutEngineRow (storageLabel, storageBox);
+
+    engineColumn.removeFromTop (4);
+    layoutEngineRow (resampleLabel, resampleBox);
+
+    // MIDI and voice settings
+    auto layoutRow = [&area] (juce::Label& label, juce::Component& box, juce::Button* learnButton)
     {
         auto row = area.removeFromTop (28);
-        nextCCBox.setBounds (row.removeFromLeft (200));
-        row.removeFromLeft (8);
-        nextLearnButton.setBounds (row.removeFromLeft (90));
-    }
+        label.setBounds (row.removeFromLeft (130));
+        box.setBounds (row.removeFromLeft (150));
+
+        if (learnButton != nullptr)
+        {
+            row.removeFromLeft (8);
+            learnButton->setBounds (row.removeFromLeft (70));
+        }
+    };
+
+    layoutRow (navChannelLabel, navChannelBox, nullptr);
+    area.removeFromTop (4);
+    layoutRow (prevCCLabel, prevCCBox, &prevLearnButton);
+    area.removeFromTop (4);
+    layoutRow (nextCCLabel, nextCCBox, &nextLearnButton);
+    area.removeFromTop (4);
+    layoutRow (programChangeLabel, programChangeBox, nullptr);
+    area.removeFromTop (4);
+    layoutRow (padChannelsLabel, padChannelsButton, nullptr);
+
+    area.removeFromTop (12);
+    layoutRow (maxVoicesLabel, maxVoicesBox, nullptr);
+    area.removeFromTop (4);
+    layoutRow (stealPolicyLabel, stealPolicyBox, nullptr);
 
     area.removeFromTop (20);
     savePresetButton.setBounds (area.removeFromTop (32).withWidth (160));
@@ -603,7 +876,7 @@ BeatwerkEditor::BeatwerkEditor (BeatwerkProcessor& p)
                     auto oldMapping = pmm.loadMapping (oldPresetId);
                     if (oldMapping.has_value())
                     {
-                        pmm.saveMapping (newPresetId, oldMapping->pads, oldMapping->volumes);
+                        pmm.saveMapping (newPresetId, *oldMapping);
                         pmm.clearMapping (oldPresetId);
                     }
                 }
@@ -630,14 +903,7 @@ BeatwerkEditor::BeatwerkEditor (BeatwerkProcessor& p)
                     auto name = alertWin->getTextEditorContents ("name").trim();
                     if (name.isNotEmpty())
                     {
-                        std::map<int, juce::File> mappings;
-                        for (auto& pad : processorRef.getMidiMapper().getAllPads())
-                        {
-                            auto file = processorRef.getSampleEngine().getSampleFile (pad.midiNote);
-                            if (file.existsAsFile())
-                                mappings[pad.midiNote] = file;
-                        }
-                        processorRef.getPresetManager().savePreset (name, mappings);
+                        processorRef.saveCurrentKitAsPreset (name);
                         processorRef.getPresetManager().scanForPresets();
                         presetListComponent->refreshPresetList();
                         updatePresetLabel();
@@ -650,33 +916,54 @@ BeatwerkEditor::BeatwerkEditor (BeatwerkProcessor& p)
 
     rebuildPadGrid();
 
-    processorRef.onMidiTrigger = [this] (int midiNote, float velocity)
-    {
-        juce::MessageManager::callAsync ([this, midiNote, velocity]
-        {
-            for (auto* pad : padComponents)
-            {
-                if (pad->getMidiNote() == midiNote)
-                {
-                    pad->triggerFlash (velocity);
-                    break;
-                }
-            }
-        });
-    };
-
     processorRef.getPresetManager().onPresetLoaded = [this] (const DkitPreset& kit)
     {
         processorRef.loadKitSamples (kit);
         juce::MessageManager::callAsync ([this]
         {
             updatePresetLabel();
-            refreshPads();
             if (presetListComponent != nullptr)
                 presetListComponent->setActivePreset (processorRef.getPresetManager().getCurrentPresetIndex());
         });
     };
 
+    processorRef.getKitLoader().onPadLoaded = [this] (int midiNote, int padsDone, int padsTotal)
+    {
+        showKitLoadProgress (midiNote, padsDone, padsTotal);
+    };
+
+    processorRef.onKitLoaded = [this]
+    {
+        updatePresetLabel();
+        refreshPads();
+
+        if (presetListComponent != nullptr)
+            presetListComponent->setActivePreset (processorRef.getPresetManager().getCurrentPresetIndex());
+    };
+
+    processorRef.onPresetListChanged = [this]
+    {
+        if (presetListComponent != nullptr)
+        {
+            presetListComponent->refreshPresetList();
+            presetListComponent->setActivePreset (processorRef.getPresetManager().getCurrentPresetIndex());
+        }
+        updatePresetLabel();
+    };
+
+    processorRef.onSampleFilesChanged = [this] (const DirectoryWatcher::ChangeList& changes)
+    {
+        if (sampleBrowser != nullptr)
+            sampleBrowser->applyFileChanges (changes);
+    };
+
+    processorRef.onPresetChanged = [this]
+    {
+        updatePresetLabel();
+        if (presetListComponent != nullptr)
+            presetListComponent->setActivePreset (processorRef.getPresetManager().getCurrentPresetIndex());
+    };
+
     processorRef.onKitChanged = [this]
     {
         juce::MessageManager::callAsync ([safeThis = juce::Component::SafePointer<BeatwerkEditor> (this)]
@@ -693,15 +980,43 @@ BeatwerkEditor::BeatwerkEditor (BeatwerkProcessor& p)
     setSize (820, 660);
     setResizable (true, true);
     setResizeLimits (600, 500, 1600, 1200);
+
+    startTimerHz (30);
 }
 
 BeatwerkEditor::~BeatwerkEditor()
 {
-    processorRef.onMidiTrigger = nullptr;
     processorRef.onKitChanged = nullptr;
+    processorRef.onPresetChanged = nullptr;
+    processorRef.onPresetListChanged = nullptr;
+    processorRef.onSampleFilesChanged = nullptr;
+    processorRef.getKitLoader().onPadLoaded = nullptr;
+    processorRef.onKitLoaded = nullptr;
     setLookAndFeel (nullptr);
 }
 
+void BeatwerkEditor::timerCallback()
+{
+    // However many hits arrived since the last tick, each pad flashes once
+    std::array<float, 128> hits {};
+    std::array<BeatwerkProcessor::TriggerEvent, 128> events;
+
+    while (int numEvents = processorRef.readTriggerEvents (events.data(), (int) events.size()))
+    {
+        for (int i = 0; i < numEvents; ++i)
+        {
+            auto& event = events[(size_t) i];
+            if (juce::isPositiveAndBelow (event.midiNote, 128))
+                hits[(size_t) event.midiNote] = juce::jmax (hits[(size_t) event.midiNote], event.velocity);
+        }
+    }
+
+    for (int note = 0; note < 128; ++note)
+        if (hits[(size_t) note] > 0.0f)
+            if (auto* pad = findPad (note))
+                pad->triggerFlash (hits[(size_t) note]);
+}
+
 void BeatwerkEditor::paint (juce::Graphics& g)
 {
     g.fillAll (DarkLookAndFeel::bgDark);
@@ -766,8 +1081,14 @@ void BeatwerkEditor::refreshPads()
         pad->updateSampleDisplay();
 }
 
+PadComponent* BeatwerkEditor::findPad (int midiNote) const
+{
+    return juce::isPositiveAndBelow (midiNote, 128) ? padForNote[(size_t) midiNote] : nullptr;
+}
+
 void BeatwerkEditor::rebuildPadGrid()
 {
+    padForNote.fill (nullptr);
     padComponents.clear (true);
 
     for (auto& padInfo : processorRef.getMidiMapper().getAllPads())
@@ -792,14 +1113,35 @@ void BeatwerkEditor::rebuildPadGrid()
         {
             showSampleInBrowser (file);
         };
-        pad->onVolumeChanged = [this] (int midiNote, float volume)
+        pad->attachParameters (processorRef.getParameters());
+        pad->onVolumeChanged = [this] (int, float)
+        {
+            processorRef.saveCurrentMappingOverlay();
+        };
+        pad->onChokeGroupChanged = [this] (int midiNote, int group)
+        {
+            processorRef.getSampleEngine().setPadChokeGroup (midiNote, group);
+            processorRef.saveCurrentMappingOverlay();
+        };
+        pad->onSoundChanged = [this] (int midiNote, const SampleEngine::PadSound& sound)
+        {
+            processorRef.setPadSound (midiNote, sound);
+        };
+        pad->onSoundEditFinished = [this] (int)
         {
-            processorRef.getSampleEngine().setPadVolume (midiNote, volume);
+            processorRef.saveCurrentMappingOverlay();
+        };
+        pad->onOutputChanged = [this] (int midiNote, int bus)
+        {
+            processorRef.getSampleEngine().setPadOutput (midiNote, bus);
             processorRef.saveCurrentMappingOverlay();
         };
         pad->setVisible (! showingPresetList);
         addAndMakeVisible (pad);
         padComponents.add (pad);
+
+        if (juce::isPositiveAndBelow (padInfo.midiNote, 128) && padForNote[(size_t) padInfo.midiNote] == nullptr)
+            padForNote[(size_t) padInfo.midiNote] = pad;
     }
 }
 
@@ -824,6 +1166,22 @@ void BeatwerkEditor::updatePresetLabel()
     }
 }
 
+void BeatwerkEditor::showKitLoadProgress (int midiNote, int padsDone, int padsTotal)
+{
+    if (! processorRef.getKitLoader().isLoading())
+        return;
+
+    auto& pm = processorRef.getPresetManager();
+    auto name = processorRef.isRestoringState() ? juce::String ("Restoring session")
+                                                : pm.getPresetName (pm.getCurrentPresetIndex());
+    presetLabel.setText (name + "  (loading " + juce::String (padsDone) + "/" + juce::String (padsTotal) + ")",
+                         juce::dontSendNotification);
+
+    if (processorRef.getKitLoader().getPublishMode() == KitLoader::PublishMode::PerPad)
+        if (auto* pad = findPad (midiNote))
+            pad->updateSampleDisplay();
+}
+
 void BeatwerkEditor::togglePresetView()
 {
     showingPresetList = ! showingPresetList;
@@ -7,13 +7,15 @@
 #include "SampleBrowserComponent.h"
 #include "LookAndFeel.h"
 
-class SettingsOverlay : public juce::Component
+class SettingsOverlay : public juce::Component,
+                        public juce::Timer
 {
 public:
     SettingsOverlay (BeatwerkProcessor& proc);
     ~SettingsOverlay() override;
     void paint (juce::Graphics& g) override;
     void resized() override;
+    void timerCallback() override;
 
     std::function<void()> onClose;
 
@@ -49,6 +51,35 @@ private:
     juce::Label nextCCLabel;
     juce::ComboBox nextCCBox;
     juce::TextButton nextLearnButton { "Learn" };
+    juce::Label programChangeLabel;
+    juce::ComboBox programChangeBox;
+    juce::Label padChannelsLabel;
+    juce::TextButton padChannelsButton;
+
+    juce::Label kitLoadModeLabel;
+    juce::ComboBox kitLoadModeBox;
+
+    juce::Label cacheBudgetLabel;
+    juce::ComboBox cacheBudgetBox;
+    juce::Label cacheStatsLabel;
+
+    juce::Label prefetchLabel;
+    juce::ComboBox prefetchDepthBox;
+    juce::Label prefetchStatsLabel;
+
+    juce::Label streamingLabel;
+    juce::ComboBox streamingBox;
+
+    juce::Label storageLabel;
+    juce::ComboBox storageBox;
+
+    juce::Label resampleLabel;
+    juce::ComboBox resampleBox;
+
+    juce::Label maxVoicesLabel;
+    juce::ComboBox maxVoicesBox;
+    juce::Label stealPolicyLabel;
+    juce::ComboBox stealPolicyBox;
 
     juce::TextButton savePresetButton { "Save Preset..." };
     juce::TextButton closeButton { juce::CharPointer_UTF8 ("\xc3\x97") };
@@ -57,11 +88,16 @@ private:
     void populateKitBox();
     void updateKitInfoLabel();
     void updateLearnButtonStates();
+    void updatePadChannelsButton();
+    void showPadChannelsMenu();
+    void updateCacheStatsLabel();
+    void updatePrefetchStatsLabel();
     void doAbletonImport();
 };
 
 class BeatwerkEditor : public juce::AudioProcessorEditor,
-                             public juce::DragAndDropContainer
+                             public juce::DragAndDropContainer,
+                             public juce::Timer
 {
 public:
     BeatwerkEditor (BeatwerkProcessor&);
@@ -69,6 +105,7 @@ public:
 
     void paint (juce::Graphics&) override;
     void resized() override;
+    void timerCallback() override;
 
     void refreshPads();
     void rebuildPadGrid();
@@ -90,6 +127,8 @@ private:
     juce::TextButton settingsButton { "Settings" };
 
     juce::OwnedArray<PadComponent> padComponents;
+    std::array<PadComponent*, 128> padForNote {};
+    PadComponent* findPad (int midiNote) const;
 
     std::unique_ptr<SampleBrowserComponent> sampleBrowser;
     bool showingSampleBrowser = false;
@@ -105,5 +144,7 @@ private:
     void showSettings();
     void hideSettings();
 
+    void showKitLoadProgress (int midiNote, int padsDone, int padsTotal);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BeatwerkEditor)
 };
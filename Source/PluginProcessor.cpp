@@ -1,19 +1,189 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "StateFormat.h"
+
+// The main stereo out plus optional stereo outs that pads can be routed to
+static juce::AudioProcessor::BusesProperties makeBusesProperties()
+{
+    juce::AudioProcessor::BusesProperties buses;
+    buses.addBus (false, "Output", juce::AudioChannelSet::stereo(), true);
+
+    for (int bus = 2; bus <= SampleEngine::kMaxOutputBuses; ++bus)
+        buses.addBus (false, "Out " + juce::String (bus), juce::AudioChannelSet::stereo(), false);
+
+    return buses;
+}
 
 BeatwerkProcessor::BeatwerkProcessor()
-    : AudioProcessor (BusesProperties()
-                      .withOutput ("Output", juce::AudioChannelSet::stereo(), true))
+    : AudioProcessor (makeBusesProperties())
 {
+    for (int note = 0; note < 128; ++note)
+    {
+        volumeParameters[(size_t) note] = parameters.getParameter ("volume" + juce::String (note));
+        panParameters[(size_t) note] = parameters.getParameter ("pan" + juce::String (note));
+        parameters.addParameterListener ("volume" + juce::String (note), this);
+        parameters.addParameterListener ("pan" + juce::String (note), this);
+    }
+
+    kitLoader.onKitLoaded = [this]
+    {
+        // The kit of a session restore keeps the volumes and pans the host
+        // just restored; any other kit brings its own
+        if (isRestoringState())
+        {
+            finishRestore();
+            pushParametersToEngine();
+        }
+        else
+        {
+            syncParametersFromEngine();
+        }
+
+        if (onKitLoaded)
+            onKitLoaded();
+    };
+
     presetManager.onPresetLoaded = [this] (const DkitPreset& kit)
     {
         loadKitSamples (kit);
     };
 
-    juce::Thread::launch ([this] { presetManager.scanForPresets(); });
+    presetManager.loadPresetIndex();
+
+    presetsWatcher.onChanges = [this] (const DirectoryWatcher::ChangeList& changes)
+    {
+        if (presetManager.applyFileChanges (changes) && onPresetListChanged)
+            onPresetListChanged();
+    };
+    presetsWatcher.setDirectory (presetManager.getPresetsDir());
+
+    samplesWatcher.onChanges = [this] (const DirectoryWatcher::ChangeList& changes)
+    {
+        for (auto& change : changes)
+        {
+            sampleEngine.getSampleCache().invalidate (change.file);
+            if (change.type == DirectoryWatcher::Change::Type::Renamed)
+                sampleEngine.getSampleCache().invalidate (change.previousFile);
+        }
+
+        if (presetManager.applySampleFileChanges (changes) && onPresetListChanged)
+            onPresetListChanged();
+
+        if (onSampleFilesChanged)
+            onSampleFilesChanged (changes);
+    };
+    samplesWatcher.setDirectory (presetManager.getSamplesDir());
+
+    presetManager.scanForPresetsInBackground ([this]
+    {
+        if (onPresetListChanged)
+            onPresetListChanged();
+    });
+}
+
+BeatwerkProcessor::~BeatwerkProcessor()
+{
+    for (int note = 0; note < 128; ++note)
+    {
+        parameters.removeParameterListener ("volume" + juce::String (note), this);
+        parameters.removeParameterListener ("pan" + juce::String (note), this);
+    }
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout BeatwerkProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    for (int note = 0; note < 128; ++note)
+    {
+        auto name = "Note " + juce::String (note);
+        layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "volume" + juce::String (note), 1 },
+                                                                 name + " Volume",
+                                                                 juce::NormalisableRange<float> (0.0f, 2.0f, 0.01f), 1.0f));
+        layout.add (std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "pan" + juce::String (note), 1 },
+                                                                 name + " Pan",
+                                                                 juce::NormalisableRange<float> (-1.0f, 1.0f, 0.01f), 0.0f));
+    }
+
+    return layout;
 }
 
-BeatwerkProcessor::~BeatwerkProcessor() {}
+// May run on the audio thread during automation
+void BeatwerkProcessor::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    int note = parameterID.getTrailingIntValue();
+
+    if (parameterID.startsWith ("volume"))
+        sampleEngine.setPadVolume (note, newValue);
+    else
+        sampleEngine.setPadPan (note, newValue);
+
+    ++parameterVersion;
+}
+
+// Kit loads, swaps and restores set many pads at once. They set the value
+// without notifying the host, so nothing is recorded as automation or undo
+// and no listener echoes it back into the engine.
+bool BeatwerkProcessor::setPadParameter (const PadParameters& padParameters, int midiNote, float value)
+{
+    if (midiNote < 0 || midiNote >= (int) padParameters.size())
+        return false;
+
+    auto* parameter = padParameters[(size_t) midiNote];
+    if (std::abs (parameter->convertFrom0to1 (parameter->getValue()) - value) <= 0.001f)
+        return false;
+
+    parameter->setValue (parameter->convertTo0to1 (value));
+    ++parameterVersion;
+    return true;
+}
+
+// Kit loads and pad swaps change the engine's volumes and pans directly.
+// The host is asked to re-read the parameters instead.
+void BeatwerkProcessor::syncParametersFromEngine()
+{
+    bool changed = false;
+
+    for (int note = 0; note < 128; ++note)
+    {
+        changed = setPadParameter (volumeParameters, note, sampleEngine.getPadVolume (note)) || changed;
+        changed = setPadParameter (panParameters, note, sampleEngine.getPadPan (note)) || changed;
+    }
+
+    if (changed)
+        updateHostDisplay (juce::AudioProcessorListener::ChangeDetails().withParameterInfoChanged (true));
+}
+
+void BeatwerkProcessor::restoreParameters (const juce::ValueTree& parametersTree)
+{
+    for (auto parameterTree : parametersTree)
+    {
+        auto id = parameterTree.getProperty ("id").toString();
+        int note = id.getTrailingIntValue();
+
+        if (id.startsWith ("volume"))
+            setPadParameter (volumeParameters, note, (float) parameterTree.getProperty ("value", 1.0f));
+        else if (id.startsWith ("pan"))
+            setPadParameter (panParameters, note, (float) parameterTree.getProperty ("value", 0.0f));
+    }
+}
+
+void BeatwerkProcessor::pushParametersToEngine()
+{
+    for (int note = 0; note < 128; ++note)
+    {
+        auto& volume = *volumeParameters[(size_t) note];
+        auto& pan = *panParameters[(size_t) note];
+        sampleEngine.setPadVolume (note, volume.convertFrom0to1 (volume.getValue()));
+        sampleEngine.setPadPan (note, pan.convertFrom0to1 (pan.getValue()));
+    }
+}
+
+void BeatwerkProcessor::setPadSound (int midiNote, const SampleEngine::PadSound& sound)
+{
+    sampleEngine.setPadSound (midiNote, sound);
+    setPadParameter (panParameters, midiNote, sound.pan);
+}
 
 void BeatwerkProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
@@ -31,6 +201,13 @@ bool BeatwerkProcessor::isBusesLayoutSupported (const BusesLayout& layouts) cons
         && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 
+    for (int bus = 1; bus < layouts.outputBuses.size(); ++bus)
+    {
+        auto set = layouts.getChannelSet (false, bus);
+        if (! set.isDisabled() && set != juce::AudioChannelSet::stereo())
+            return false;
+    }
+
     return true;
 }
 
@@ -40,6 +217,17 @@ void BeatwerkProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     juce::ScopedNoDenormals noDenormals;
     buffer.clear();
 
+    SampleEngine::OutputLayout outputs {};
+    for (int bus = 0; bus < juce::jmin (getBusCount (false), SampleEngine::kMaxOutputBuses); ++bus)
+        if (auto* outputBus = getBus (false, bus); outputBus != nullptr && outputBus->isEnabled())
+            outputs[(size_t) bus] = { getChannelIndexInProcessBlockBuffer (false, bus, 0),
+                                      outputBus->getNumberOfChannels() };
+    sampleEngine.setOutputLayout (outputs);
+
+    // Render up to each trigger so hits land on their exact sample
+    int numSamples = buffer.getNumSamples();
+    int renderedUpTo = 0;
+
     for (const auto metadata : midiMessages)
     {
         auto msg = metadata.getMessage();
@@ -47,30 +235,55 @@ void BeatwerkProcessor::processBlock (juce::AudioBuffer<float>& buffer,
         if (midiMapper.processForLearn (msg))
             continue;
 
-        auto navAction = midiMapper.processForNavigation (msg);
-        if (navAction == MidiMapper::NavAction::Next)
+        auto navCommand = midiMapper.processForNavigation (msg);
+        if (navCommand.action == MidiMapper::NavAction::Next)
+        {
+            presetNavigator.step (1);
+            continue;
+        }
+        if (navCommand.action == MidiMapper::NavAction::Previous)
         {
-            juce::MessageManager::callAsync ([this] { presetManager.loadNextPreset(); });
+            presetNavigator.step (-1);
             continue;
         }
-        if (navAction == MidiMapper::NavAction::Previous)
+        if (navCommand.action == MidiMapper::NavAction::SelectPreset)
         {
-            juce::MessageManager::callAsync ([this] { presetManager.loadPreviousPreset(); });
+            presetNavigator.select (navCommand.presetIndex);
             continue;
         }
 
         if (midiMapper.isDrumTrigger (msg))
         {
+            int position = juce::jlimit (renderedUpTo, numSamples, metadata.samplePosition);
+            if (position > renderedUpTo)
+            {
+                sampleEngine.renderNextBlock (buffer, renderedUpTo, position - renderedUpTo);
+                renderedUpTo = position;
+            }
+
             int note = msg.getNoteNumber();
             float velocity = msg.getFloatVelocity();
             sampleEngine.noteOn (note, velocity);
 
-            if (onMidiTrigger)
-                onMidiTrigger (note, velocity);
+            const auto scope = triggerFifo.write (1);
+            if (scope.blockSize1 > 0)
+                triggerEvents[(size_t) scope.startIndex1] = { note, velocity };
+            else if (scope.blockSize2 > 0)
+                triggerEvents[(size_t) scope.startIndex2] = { note, velocity };
         }
     }
 
-    sampleEngine.renderNextBlock (buffer, 0, buffer.getNumSamples());
+    if (renderedUpTo < numSamples)
+        sampleEngine.renderNextBlock (buffer, renderedUpTo, numSamples - renderedUpTo);
+}
+
+int BeatwerkProcessor::readTriggerEvents (TriggerEvent* dest, int maxEvents)
+{
+    const auto scope = triggerFifo.read (juce::jmin (maxEvents, triggerFifo.getNumReady()));
+
+    int numRead = 0;
+    scope.forEach ([this, dest, &numRead] (int index) { dest[numRead++] = triggerEvents[(size_t) index]; });
+    return numRead;
 }
 
 juce::AudioProcessorEditor* BeatwerkProcessor::createEditor()
@@ -80,137 +293,500 @@ juce::AudioProcessorEditor* BeatwerkProcessor::createEditor()
 
 void BeatwerkProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    auto state = std::make_unique<juce::XmlElement> ("BeatwerkState");
+    // The engine only holds part of a kit that is still being restored
+    if (restoringState.load())
+    {
+        std::lock_guard<std::mutex> lock (restoreMutex);
+        if (restoringState.load())
+        {
+            destData = restoringData;
+            return;
+        }
+    }
 
-    state->setAttribute ("samplesPath", presetManager.getSamplesDir().getFullPathName());
-    state->setAttribute ("presetsPath", presetManager.getPresetsDir().getFullPathName());
+    // Hosts ask on every autosave and undo step; most of the time nothing changed
+    auto key = makeSavedStateKey();
+    std::lock_guard<std::mutex> lock (savedStateMutex);
 
-    state->setAttribute ("navChannel", midiMapper.getNavChannel());
-    state->setAttribute ("prevCC", midiMapper.getPrevCCNumber());
-    state->setAttribute ("nextCC", midiMapper.getNextCCNumber());
+    if (savedStateKey == key)
+    {
+        destData = savedState;
+        return;
+    }
+
+    juce::ValueTree state ("BeatwerkState");
+
+    state.setProperty ("samplesPath", presetManager.getSamplesDir().getFullPathName(), nullptr);
+    state.setProperty ("presetsPath", presetManager.getPresetsDir().getFullPathName(), nullptr);
+
+    state.setProperty ("navChannel", midiMapper.getNavChannel(), nullptr);
+    state.setProperty ("prevCC", midiMapper.getPrevCCNumber(), nullptr);
+    state.setProperty ("nextCC", midiMapper.getNextCCNumber(), nullptr);
+    state.setProperty ("padChannels", midiMapper.getPadChannels(), nullptr);
+    state.setProperty ("programChannel", midiMapper.getProgramChangeChannel(), nullptr);
+
+    const char* actionNames[] = { "none", "next", "previous", "bankMsb", "bankLsb" };
+    juce::ValueTree controllersTree ("Controllers");
+    for (auto& [controller, action] : midiMapper.getControllerActions())
+        controllersTree.appendChild (juce::ValueTree ("Controller", { { "channel", controller.channel },
+                                                                      { "cc", controller.cc },
+                                                                      { "action", actionNames[(int) action] } }),
+                                     nullptr);
+    state.appendChild (controllersTree, nullptr);
+
+    state.setProperty ("kitLoadMode", kitLoader.getPublishMode() == KitLoader::PublishMode::PerPad ? "perPad" : "wholeKit", nullptr);
+
+    state.setProperty ("sampleCacheMB", (int) (sampleEngine.getSampleCache().getMemoryBudget() / (1024 * 1024)), nullptr);
+
+    state.setProperty ("prefetchDepth", prefetcher.getDepth(), nullptr);
+
+    state.setProperty ("streamPreloadMs", sampleEngine.getStreamingPreloadMs(), nullptr);
+    state.setProperty ("memoryMapSamples", sampleEngine.isMemoryMappingEnabled(), nullptr);
+
+    const char* qualityNames[] = { "fast", "medium", "high" };
+    state.setProperty ("resampleQuality", qualityNames[(int) sampleEngine.getResampleQuality()], nullptr);
+
+    const char* stealPolicyNames[] = { "oldest", "quietest", "lowestVelocity" };
+    state.setProperty ("maxVoices", sampleEngine.getMaxVoices(), nullptr);
+    state.setProperty ("stealPolicy", stealPolicyNames[(int) sampleEngine.getStealPolicy()], nullptr);
+
+    state.setProperty ("drumKit", midiMapper.getActiveKitId(), nullptr);
+    state.setProperty ("presetIndex", presetManager.getCurrentPresetIndex(), nullptr);
+
+    // Pad volume and pan live in the parameters. Kit loads set them without
+    // notifying, which leaves the APVTS copy of their values behind.
+    juce::ValueTree parametersTree (parameters.state.getType());
+    for (auto* padParameters : { &volumeParameters, &panParameters })
+    {
+        for (auto* parameter : *padParameters)
+            parametersTree.appendChild (juce::ValueTree ("PARAM", { { "id", parameter->getParameterID() },
+                                                                    { "value", parameter->convertFrom0to1 (parameter->getValue()) } }),
+                                        nullptr);
+    }
+    state.appendChild (parametersTree, nullptr);
 
-    state->setAttribute ("drumKit", midiMapper.getActiveKitId());
-    state->setAttribute ("presetIndex", presetManager.getCurrentPresetIndex());
+    // Built from what the engine already holds: saving never touches the disk
+    StateFormat::PathTable paths (presetManager.getSamplesDir());
 
-    auto* padsEl = state->createNewChildElement ("PadMappings");
+    juce::ValueTree padsTree ("PadMappings");
     for (auto& pad : midiMapper.getAllPads())
     {
-        auto file = sampleEngine.getSampleFile (pad.midiNote);
-        if (file.existsAsFile())
+        if (! sampleEngine.hasSample (pad.midiNote))
+            continue;
+
+        juce::ValueTree padTree ("Pad");
+        padTree.setProperty ("note", pad.midiNote, nullptr);
+        padTree.setProperty ("path", paths.intern (sampleEngine.getSampleFile (pad.midiNote)), nullptr);
+
+        int numVoices = sampleEngine.getPadPolyphony (pad.midiNote);
+        if (numVoices != SampleEngine::kDefaultPadPolyphony)
+            padTree.setProperty ("voices", numVoices, nullptr);
+
+        if (int group = sampleEngine.getPadChokeGroup (pad.midiNote); group > 0)
+            padTree.setProperty ("chokeGroup", group, nullptr);
+
+        if (int output = sampleEngine.getPadOutput (pad.midiNote); output > 0)
+            padTree.setProperty ("output", output, nullptr);
+
+        if (auto sound = sampleEngine.getPadSound (pad.midiNote); sound.tune != 0.0f || sound.attackMs > 0.0f
+                                                                   || sound.holdMs > 0.0f || sound.decayMs > 0.0f)
         {
-            auto* padEl = padsEl->createNewChildElement ("Pad");
-            padEl->setAttribute ("note", pad.midiNote);
-            padEl->setAttribute ("file", file.getFullPathName());
+            padTree.setProperty ("tune", sound.tune, nullptr);
+            padTree.setProperty ("attack", sound.attackMs, nullptr);
+            padTree.setProperty ("hold", sound.holdMs, nullptr);
+            padTree.setProperty ("decay", sound.decayMs, nullptr);
+        }
 
-            float vol = sampleEngine.getPadVolume (pad.midiNote);
-            if (std::abs (vol - 1.0f) > 0.001f)
-                padEl->setAttribute ("volume", (double) vol);
+        for (auto& layer : sampleEngine.getPadLayers (pad.midiNote))
+        {
+            juce::ValueTree layerTree ("Layer");
+            layerTree.setProperty ("velocityLow", layer.velocityLow, nullptr);
+            layerTree.setProperty ("velocityHigh", layer.velocityHigh, nullptr);
+
+            for (auto& sample : layer.roundRobin)
+                layerTree.appendChild (juce::ValueTree ("Sample", { { "path", paths.intern (sample->file) } }), nullptr);
+
+            padTree.appendChild (layerTree, nullptr);
         }
+
+        padsTree.appendChild (padTree, nullptr);
     }
+    state.appendChild (padsTree, nullptr);
 
-    copyXmlToBinary (*state, destData);
+    StateFormat::write (state, paths, destData);
+
+    savedState = destData;
+    savedStateKey = key;
+}
+
+BeatwerkProcessor::SavedStateKey BeatwerkProcessor::makeSavedStateKey()
+{
+    SavedStateKey key;
+    key.samplesDir = presetManager.getSamplesDir();
+    key.presetsDir = presetManager.getPresetsDir();
+    key.navChannel = midiMapper.getNavChannel();
+    key.prevCC = midiMapper.getPrevCCNumber();
+    key.nextCC = midiMapper.getNextCCNumber();
+    key.padChannels = midiMapper.getPadChannels();
+    key.programChannel = midiMapper.getProgramChangeChannel();
+    key.controllerActionsVersion = midiMapper.getControllerActionsVersion();
+    key.drumKit = midiMapper.getActiveKitId();
+    key.kitLoadMode = kitLoader.getPublishMode();
+    key.sampleCacheBytes = sampleEngine.getSampleCache().getMemoryBudget();
+    key.prefetchDepth = prefetcher.getDepth();
+    key.streamPreloadMs = sampleEngine.getStreamingPreloadMs();
+    key.memoryMapSamples = sampleEngine.isMemoryMappingEnabled();
+    key.resampleQuality = sampleEngine.getResampleQuality();
+    key.maxVoices = sampleEngine.getMaxVoices();
+    key.stealPolicy = sampleEngine.getStealPolicy();
+    key.presetIndex = presetManager.getCurrentPresetIndex();
+    key.padStateVersion = sampleEngine.getPadStateVersion();
+    key.parameterVersion = parameterVersion.load();
+    return key;
 }
 
 void BeatwerkProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    auto state = getXmlFromBinary (data, sizeInBytes);
-    if (state == nullptr || ! state->hasTagName ("BeatwerkState"))
+    // Sessions saved before the binary format hold the same tree as XML,
+    // with full paths in "file" properties instead of path table indices
+    StateFormat::PathTable paths (presetManager.getSamplesDir());
+    juce::ValueTree state;
+
+    if (StateFormat::isStateData (data, (size_t) sizeInBytes))
+        state = StateFormat::read (data, (size_t) sizeInBytes, paths);
+    else if (auto xml = getXmlFromBinary (data, sizeInBytes))
+        state = juce::ValueTree::fromXml (*xml);
+
+    if (! state.hasType ("BeatwerkState"))
         return;
 
-    auto samplesPath = state->getStringAttribute ("samplesPath");
+    auto samplesPath = state.getProperty ("samplesPath").toString();
     if (samplesPath.isNotEmpty())
         presetManager.setSamplesDir (juce::File (samplesPath));
 
-    auto presetsPath = state->getStringAttribute ("presetsPath");
+    samplesWatcher.setDirectory (presetManager.getSamplesDir());
+    paths.setBaseDirectory (presetManager.getSamplesDir());
+
+    auto fileOf = [&paths] (const juce::ValueTree& tree)
+    {
+        return tree.hasProperty ("path") ? paths.resolve (tree.getProperty ("path"))
+                                         : juce::File (tree.getProperty ("file").toString());
+    };
+
+    auto presetsPath = state.getProperty ("presetsPath").toString();
     if (presetsPath.isNotEmpty())
         presetManager.setPresetsDir (juce::File (presetsPath));
 
-    auto drumKitId = state->getStringAttribute ("drumKit");
+    presetsWatcher.setDirectory (presetManager.getPresetsDir());
+
+    auto drumKitId = state.getProperty ("drumKit").toString();
     if (drumKitId.isNotEmpty())
         midiMapper.setActiveKit (drumKitId);
     else
         midiMapper.setActiveKit ("millenium_mps_1000");
 
-    midiMapper.setNavChannel (state->getIntAttribute ("navChannel", 0));
-    midiMapper.setPrevCCNumber (state->getIntAttribute ("prevCC",
-        state->getIntAttribute ("navCC", 1)));
-    midiMapper.setNextCCNumber (state->getIntAttribute ("nextCC", 2));
+    midiMapper.setNavChannel ((int) state.getProperty ("navChannel", 0));
+    midiMapper.setPrevCCNumber ((int) state.getProperty ("prevCC", state.getProperty ("navCC", 1)));
+    midiMapper.setNextCCNumber ((int) state.getProperty ("nextCC", 2));
+    midiMapper.setPadChannels ((int) state.getProperty ("padChannels", 0xffff));
+    midiMapper.setProgramChangeChannel ((int) state.getProperty ("programChannel", -1));
 
-    auto* padsEl = state->getChildByName ("PadMappings");
-    if (padsEl != nullptr)
+    MidiMapper::ControllerActionMap controllerActions;
+    for (auto controllerTree : state.getChildWithName ("Controllers"))
     {
-        for (auto* padEl : padsEl->getChildIterator())
+        auto action = controllerTree.getProperty ("action").toString();
+        controllerActions[{ controllerTree.getProperty ("channel", 0), controllerTree.getProperty ("cc", -1) }] =
+            action == "next" ? MidiMapper::ControllerAction::Next
+            : action == "previous" ? MidiMapper::ControllerAction::Previous
+            : action == "bankMsb" ? MidiMapper::ControllerAction::BankMsb
+            : action == "bankLsb" ? MidiMapper::ControllerAction::BankLsb
+                                  : MidiMapper::ControllerAction::None;
+    }
+    midiMapper.setControllerActions (controllerActions);
+
+    kitLoader.setPublishMode (state.getProperty ("kitLoadMode").toString() == "perPad"
+                                  ? KitLoader::PublishMode::PerPad
+                                  : KitLoader::PublishMode::WholeKit);
+
+    prefetcher.setDepth ((int) state.getProperty ("prefetchDepth", 1));
+
+    sampleEngine.setStreamingPreloadMs ((int) state.getProperty ("streamPreloadMs", 0));
+    sampleEngine.setMemoryMappingEnabled ((bool) state.getProperty ("memoryMapSamples", true));
+
+    auto quality = state.getProperty ("resampleQuality", "medium").toString();
+    sampleEngine.setResampleQuality (quality == "fast" ? Resampler::Quality::Fast
+                                     : quality == "high" ? Resampler::Quality::High
+                                                         : Resampler::Quality::Medium);
+
+    sampleEngine.setMaxVoices ((int) state.getProperty ("maxVoices", SampleEngine::kDefaultMaxVoices));
+
+    auto stealPolicy = state.getProperty ("stealPolicy").toString();
+    sampleEngine.setStealPolicy (stealPolicy == "quietest" ? SampleEngine::StealPolicy::Quietest
+                                 : stealPolicy == "lowestVelocity" ? SampleEngine::StealPolicy::LowestVelocity
+                                                                   : SampleEngine::StealPolicy::Oldest);
+
+    if (state.hasProperty ("sampleCacheMB"))
+        sampleEngine.getSampleCache().setMemoryBudget ((juce::int64) (int) state.getProperty ("sampleCacheMB") * 1024 * 1024);
+
+    auto parametersTree = state.getChildWithName (parameters.state.getType());
+    if (parametersTree.isValid())
+        restoreParameters (parametersTree);
+
+    // The samples are decoded by a single kit load in the background, so
+    // restoring never waits on the disk. Publishing the kit resets every
+    // pad, so the pad settings travel with the request.
+    KitLoader::KitRequest request;
+
+    for (auto padTree : state.getChildWithName ("PadMappings"))
+    {
+        int note = padTree.getProperty ("note", -1);
+        if (note < 0)
+            continue;
+
+        KitLoader::PadRequest padRequest { note, fileOf (padTree), {}, {} };
+
+        for (auto layerTree : padTree)
         {
-            int note = padEl->getIntAttribute ("note", -1);
-            auto filePath = padEl->getStringAttribute ("file");
-            if (note >= 0 && filePath.isNotEmpty())
-            {
-                juce::File file (filePath);
-                if (file.existsAsFile())
-                    sampleEngine.loadSample (note, file);
-            }
+            if (! layerTree.hasType ("Layer"))
+                continue;
 
-            if (note >= 0 && padEl->hasAttribute ("volume"))
-                sampleEngine.setPadVolume (note, (float) padEl->getDoubleAttribute ("volume", 1.0));
+            KitLoader::LayerRequest layer { layerTree.getProperty ("velocityLow", 1),
+                                            layerTree.getProperty ("velocityHigh", 127), {} };
+
+            for (auto sampleTree : layerTree)
+                layer.files.push_back (fileOf (sampleTree));
+
+            padRequest.layers.push_back (std::move (layer));
         }
+
+        if (padRequest.file != juce::File())
+        {
+            padRequest.missingName = padRequest.file.getFileNameWithoutExtension();
+            request.pads.push_back (std::move (padRequest));
+        }
+
+        if (padTree.hasProperty ("voices"))
+            request.polyphony[note] = padTree.getProperty ("voices");
+
+        request.chokeGroups[note] = padTree.getProperty ("chokeGroup", 0);
+        request.outputs[note] = padTree.getProperty ("output", 0);
+        request.sounds[note] = { (float) padTree.getProperty ("pan", 0.0f),
+                                 (float) padTree.getProperty ("tune", 0.0f),
+                                 (float) padTree.getProperty ("attack", 0.0f),
+                                 (float) padTree.getProperty ("hold", 0.0f),
+                                 (float) padTree.getProperty ("decay", 0.0f) };
+
+        // Older sessions kept volume and pan on the pad
+        if (! parametersTree.isValid())
+        {
+            setPadParameter (volumeParameters, note, (float) padTree.getProperty ("volume", 1.0f));
+            setPadParameter (panParameters, note, (float) padTree.getProperty ("pan", 0.0f));
+        }
+    }
+
+    pushParametersToEngine();
+    updateHostDisplay (juce::AudioProcessorListener::ChangeDetails().withParameterInfoChanged (true));
+
+    for (int note = 0; note < 128; ++note)
+    {
+        request.volumes[note] = sampleEngine.getPadVolume (note);
+        request.sounds[note].pan = sampleEngine.getPadPan (note);
+    }
+
+    // The saved pads already include the preset and its custom mapping, so
+    // the preset is only selected; it is loaded when the state has no pads
+    int presetIdx = state.getProperty ("presetIndex", -1);
+    bool loadPreset = request.pads.empty();
+
+    if (! loadPreset || presetIdx >= 0)
+    {
+        std::lock_guard<std::mutex> lock (restoreMutex);
+        restoringData.replaceAll (data, (size_t) sizeInBytes);
+        restoringState.store (true);
     }
 
-    int presetIdx = state->getIntAttribute ("presetIndex", -1);
     if (presetIdx >= 0)
     {
-        juce::MessageManager::callAsync ([this, presetIdx]
+        // The index is only valid once the presets directory has been
+        // rescanned, which happens off the message thread
+        juce::MessageManager::callAsync ([this, presetIdx, loadPreset]
         {
-            presetManager.scanForPresets();
-            presetManager.loadPreset (presetIdx);
+            presetManager.scanForPresetsInBackground ([this, presetIdx, loadPreset]
+            {
+                if (! loadPreset)
+                {
+                    if (presetManager.selectPreset (presetIdx))
+                        schedulePrefetch();
+                }
+                else if (! presetManager.loadPreset (presetIdx))
+                {
+                    finishRestore();
+                }
+
+                if (onPresetListChanged)
+                    onPresetListChanged();
+            });
         });
     }
+
+    if (! loadPreset)
+        kitLoader.loadKit (std::move (request));
+}
+
+void BeatwerkProcessor::finishRestore()
+{
+    std::lock_guard<std::mutex> lock (restoreMutex);
+    restoringState.store (false);
+    restoringData.reset();
 }
 
 void BeatwerkProcessor::loadKitSamples (const DkitPreset& kit)
 {
-    sampleEngine.clearAllSamples();
+    prefetcher.notePresetLoaded (kit.sourceFile);
+    kitLoader.loadKit (makeRequestWithDefaults (kit, presetManager.getSamplesDir(), &padMappingManager));
+    schedulePrefetch();
+}
 
-    auto presetId = PadMappingManager::makePresetId (kit.sourceFile);
-    auto customMapping = padMappingManager.loadMapping (presetId);
+void BeatwerkProcessor::loadNavigatedPreset (int index, const DkitPreset& kit, const juce::File& samplesDir)
+{
+    // Navigator thread: the kit loader publishes to the engine lock-free,
+    // and the preset list is only read through the navigator's snapshot
+    prefetcher.notePresetLoaded (kit.sourceFile);
+    kitLoader.loadKit (makeRequestWithDefaults (kit, samplesDir, &padMappingManager));
+
+    juce::MessageManager::callAsync ([this, index, kit]
+    {
+        presetManager.selectPreset (index, kit);
+        presetNavigator.presetCommitted();
+        schedulePrefetch();
+
+        if (onPresetChanged)
+            onPresetChanged();
+    });
+}
+
+KitLoader::KitRequest BeatwerkProcessor::makeRequestWithDefaults (const DkitPreset& kit, const juce::File& samplesDir,
+                                                                  const PadMappingManager* mappings) const
+{
+    auto request = makeKitRequest (kit, samplesDir, mappings);
+    if (request.chokeGroups.empty())
+        request.chokeGroups = midiMapper.getDefaultChokeGroups();
+    return request;
+}
 
-    if (customMapping.has_value())
+KitLoader::KitRequest BeatwerkProcessor::makeKitRequest (const DkitPreset& kit, const juce::File& samplesDir,
+                                                         const PadMappingManager* mappings)
+{
+    KitLoader::KitRequest request;
+
+    for (auto& pad : kit.pads)
+    {
+        if (pad.voices > 0)
+            request.polyphony[pad.midiNote] = pad.voices;
+        if (pad.chokeGroup > 0)
+            request.chokeGroups[pad.midiNote] = pad.chokeGroup;
+    }
+
+    if (mappings != nullptr)
     {
-        for (auto& [note, file] : customMapping->pads)
+        auto customMapping = mappings->loadMapping (PadMappingManager::makePresetId (kit.sourceFile));
+        if (customMapping.has_value())
         {
-            if (file.existsAsFile())
-                sampleEngine.loadSample (note, file);
+            for (auto& [note, file] : customMapping->pads)
+            {
+                KitLoader::PadRequest padRequest { note, file, file.getFileNameWithoutExtension(), {} };
+
+                auto layersIt = customMapping->layers.find (note);
+                if (layersIt != customMapping->layers.end())
+                    for (auto& layer : layersIt->second)
+                        padRequest.layers.push_back ({ layer.velocityLow, layer.velocityHigh, layer.files });
+
+                request.pads.push_back (std::move (padRequest));
+            }
+
+            request.volumes = customMapping->volumes;
+
+            for (auto& [note, group] : customMapping->chokeGroups)
+                request.chokeGroups[note] = group;
+
+            request.outputs = customMapping->outputs;
+
+            for (auto& [note, sound] : customMapping->sounds)
+                request.sounds[note] = { sound.pan, sound.tune, sound.attackMs, sound.holdMs, sound.decayMs };
+
+            return request;
         }
+    }
 
-        for (auto& [note, vol] : customMapping->volumes)
-            sampleEngine.setPadVolume (note, vol);
+    for (auto& pad : kit.pads)
+    {
+        if (pad.sampleFile.isEmpty())
+            continue;
+
+        KitLoader::PadRequest padRequest { pad.midiNote, PresetManager::resolveSamplePath (samplesDir, pad.sampleFile),
+                                           pad.sampleName, {} };
+
+        for (auto& layer : pad.layers)
+        {
+            KitLoader::LayerRequest layerRequest { layer.velocityLow, layer.velocityHigh, {} };
+            for (auto& sampleFile : layer.sampleFiles)
+                layerRequest.files.push_back (PresetManager::resolveSamplePath (samplesDir, sampleFile));
+            padRequest.layers.push_back (std::move (layerRequest));
+        }
+
+        request.pads.push_back (std::move (padRequest));
     }
-    else
+    return request;
+}
+
+void BeatwerkProcessor::schedulePrefetch()
+{
+    int depth = prefetcher.getDepth();
+    int numPresets = presetManager.getNumPresets();
+    int current = presetManager.getCurrentPresetIndex();
+    if (depth == 0 || numPresets < 2 || current < 0)
+        return;
+
+    // Nearest neighbours first, alternating next and previous
+    juce::Array<juce::File> files;
+    for (int distance = 1; distance <= depth; ++distance)
     {
-        for (auto& pad : kit.pads)
+        for (int index : { current + distance, current - distance })
         {
-            auto sampleFile = presetManager.resolveSamplePath (pad.sampleFile);
-            if (sampleFile.existsAsFile())
-                sampleEngine.loadSample (pad.midiNote, sampleFile);
-            else if (pad.sampleFile.isNotEmpty())
-                sampleEngine.markSampleMissing (pad.midiNote, pad.sampleName);
+            auto file = presetManager.getPresetFile (((index % numPresets) + numPresets) % numPresets);
+            if (file != juce::File() && ! files.contains (file) && file != presetManager.getCurrentKit().sourceFile)
+                files.add (file);
         }
     }
+
+    prefetcher.prefetch (files, [this, samplesDir = presetManager.getSamplesDir()] (const juce::File& presetFile)
+    {
+        return makeKitRequest (PresetManager::parseDkitJson (presetFile), samplesDir, &padMappingManager);
+    });
 }
 
 void BeatwerkProcessor::setSamplesPath (const juce::File& path)
 {
     presetManager.setSamplesDir (path);
+    samplesWatcher.setDirectory (path);
 }
 
 void BeatwerkProcessor::setPresetsPath (const juce::File& path)
 {
     presetManager.setPresetsDir (path);
-    presetManager.scanForPresets();
+    presetsWatcher.setDirectory (path);
+
+    presetManager.scanForPresetsInBackground ([this]
+    {
+        if (onPresetListChanged)
+            onPresetListChanged();
+    });
 }
 
 void BeatwerkProcessor::swapPadsAndSave (int noteA, int noteB)
 {
     sampleEngine.swapSamples (noteA, noteB);
+    syncParametersFromEngine();
     saveCurrentMappingOverlay();
 }
 
@@ -222,20 +798,70 @@ void BeatwerkProcessor::saveCurrentMappingOverlay()
 
     auto presetId = PadMappingManager::makePresetId (kit.sourceFile);
 
-    PadMappingManager::PadMapping mapping;
-    PadMappingManager::VolumeMap volumes;
+    PadMappingManager::MappingData data;
     for (auto& pad : midiMapper.getAllPads())
     {
         auto file = sampleEngine.getSampleFile (pad.midiNote);
         if (file.existsAsFile())
-            mapping[pad.midiNote] = file;
+            data.pads[pad.midiNote] = file;
 
         float vol = sampleEngine.getPadVolume (pad.midiNote);
         if (std::abs (vol - 1.0f) > 0.001f)
-            volumes[pad.midiNote] = vol;
+            data.volumes[pad.midiNote] = vol;
+
+        // Stored even when 0 so the overlay can clear a preset's group
+        data.chokeGroups[pad.midiNote] = sampleEngine.getPadChokeGroup (pad.midiNote);
+
+        if (int output = sampleEngine.getPadOutput (pad.midiNote); output > 0)
+            data.outputs[pad.midiNote] = output;
+
+        if (auto sound = sampleEngine.getPadSound (pad.midiNote); sound != SampleEngine::PadSound())
+            data.sounds[pad.midiNote] = { sound.pan, sound.tune, sound.attackMs, sound.holdMs, sound.decayMs };
+
+        for (auto& layer : sampleEngine.getPadLayers (pad.midiNote))
+        {
+            PadMappingManager::LayerMapping layerMapping { layer.velocityLow, layer.velocityHigh, {} };
+            for (auto& sample : layer.roundRobin)
+                layerMapping.files.push_back (sample->file);
+            data.layers[pad.midiNote].push_back (std::move (layerMapping));
+        }
+    }
+
+    padMappingManager.saveMapping (presetId, data);
+}
+
+bool BeatwerkProcessor::saveCurrentKitAsPreset (const juce::String& name)
+{
+    std::vector<DkitPadMapping> pads;
+    for (auto& pad : midiMapper.getAllPads())
+    {
+        auto file = sampleEngine.getSampleFile (pad.midiNote);
+        if (! file.existsAsFile())
+            continue;
+
+        DkitPadMapping mapping;
+        mapping.midiNote = pad.midiNote;
+        mapping.sampleFile = file.getFullPathName();
+        mapping.sampleName = file.getFileNameWithoutExtension();
+
+        int numVoices = sampleEngine.getPadPolyphony (pad.midiNote);
+        if (numVoices != SampleEngine::kDefaultPadPolyphony)
+            mapping.voices = numVoices;
+
+        mapping.chokeGroup = sampleEngine.getPadChokeGroup (pad.midiNote);
+
+        for (auto& layer : sampleEngine.getPadLayers (pad.midiNote))
+        {
+            DkitSampleLayer dkitLayer { layer.velocityLow, layer.velocityHigh, {} };
+            for (auto& sample : layer.roundRobin)
+                dkitLayer.sampleFiles.add (sample->file.getFullPathName());
+            mapping.layers.push_back (std::move (dkitLayer));
+        }
+
+        pads.push_back (std::move (mapping));
     }
 
-    padMappingManager.saveMapping (presetId, mapping, volumes);
+    return presetManager.savePreset (name, std::move (pads));
 }
 
 void BeatwerkProcessor::resetCurrentMappingToDefault()
@@ -247,18 +873,7 @@ void BeatwerkProcessor::resetCurrentMappingToDefault()
     auto presetId = PadMappingManager::makePresetId (kit.sourceFile);
     padMappingManager.clearMapping (presetId);
 
-    sampleEngine.clearAllSamples();
-    for (auto& pad : kit.pads)
-    {
-        auto sampleFile = presetManager.resolveSamplePath (pad.sampleFile);
-        if (sampleFile.existsAsFile())
-            sampleEngine.loadSample (pad.midiNote, sampleFile);
-        else if (pad.sampleFile.isNotEmpty())
-            sampleEngine.markSampleMissing (pad.midiNote, pad.sampleName);
-    }
-
-    for (auto& pad : midiMapper.getAllPads())
-        sampleEngine.setPadVolume (pad.midiNote, 1.0f);
+    kitLoader.loadKit (makeRequestWithDefaults (kit, presetManager.getSamplesDir(), nullptr));
 }
 
 void BeatwerkProcessor::setActiveKit (const juce::String& kitId)
@@ -2,11 +2,17 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "MidiMapper.h"
 #include "SampleEngine.h"
+#include "KitLoader.h"
+#include "PresetPrefetcher.h"
+#include "PresetNavigator.h"
+#include "DirectoryWatcher.h"
 #include "AdgParser.h"
 #include "PresetManager.h"
 #include "PadMappingManager.h"
+#include <optional>
 
-class BeatwerkProcessor : public juce::AudioProcessor
+class BeatwerkProcessor : public juce::AudioProcessor,
+                          private juce::AudioProcessorValueTreeState::Listener
 {
 public:
     BeatwerkProcessor();
@@ -40,16 +46,43 @@ public:
 
     MidiMapper& getMidiMapper() { return midiMapper; }
     SampleEngine& getSampleEngine() { return sampleEngine; }
+    KitLoader& getKitLoader() { return kitLoader; }
+    PresetPrefetcher& getPrefetcher() { return prefetcher; }
     AdgParser& getAdgParser() { return adgParser; }
     PresetManager& getPresetManager() { return presetManager; }
     PadMappingManager& getPadMappingManager() { return padMappingManager; }
+    juce::AudioProcessorValueTreeState& getParameters() { return parameters; }
 
-    std::function<void (int midiNote, float velocity)> onMidiTrigger;
+    // Pad volume and pan are host parameters, forwarded to the engine as
+    // they change. This sets pan through its parameter and the rest directly.
+    void setPadSound (int midiNote, const SampleEngine::PadSound& sound);
+
+    // True from setStateInformation until the restored kit is playing.
+    // Meanwhile getStateInformation hands back the state being restored.
+    bool isRestoringState() const { return restoringState.load(); }
+
+    // Pad hits from the audio thread, for the editor to flash its pads.
+    // Hits arriving while the queue is full are dropped. Single consumer.
+    struct TriggerEvent
+    {
+        int midiNote = 0;
+        float velocity = 0.0f;
+    };
+
+    int readTriggerEvents (TriggerEvent* dest, int maxEvents);
+
+    std::function<void()> onKitLoaded;
+    std::function<void()> onPresetChanged;   // by MIDI navigation
+    std::function<void()> onPresetListChanged;   // files changed on disk
+    std::function<void (const DirectoryWatcher::ChangeList&)> onSampleFilesChanged;
 
     void loadKitSamples (const DkitPreset& kit);
+    static KitLoader::KitRequest makeKitRequest (const DkitPreset& kit, const juce::File& samplesDir,
+                                                 const PadMappingManager* mappings);
 
     void swapPadsAndSave (int noteA, int noteB);
     void saveCurrentMappingOverlay();
+    bool saveCurrentKitAsPreset (const juce::String& name);
     void resetCurrentMappingToDefault();
 
     void setSamplesPath (const juce::File& path);
@@ -62,11 +95,72 @@ public:
     std::function<void()> onKitChanged;
 
 private:
+    using PadParameters = std::array<juce::RangedAudioParameter*, 128>;
+
+    KitLoader::KitRequest makeRequestWithDefaults (const DkitPreset& kit, const juce::File& samplesDir,
+                                                   const PadMappingManager* mappings) const;
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    bool setPadParameter (const PadParameters& padParameters, int midiNote, float value);
+    void syncParametersFromEngine();
+    void pushParametersToEngine();
+    void restoreParameters (const juce::ValueTree& parametersTree);
+    void finishRestore();
+    void loadNavigatedPreset (int index, const DkitPreset& kit, const juce::File& samplesDir);
+
     MidiMapper midiMapper;
     SampleEngine sampleEngine;
+    KitLoader kitLoader { sampleEngine };
     AdgParser adgParser;
     PresetManager presetManager;
     PadMappingManager padMappingManager;
+    PresetPrefetcher prefetcher { sampleEngine, kitLoader };
+    DirectoryWatcher presetsWatcher { "Beatwerk Presets Watcher" };
+    DirectoryWatcher samplesWatcher { "Beatwerk Samples Watcher" };
+    PresetNavigator presetNavigator { presetManager, [this] (int index, const DkitPreset& kit, const juce::File& samplesDir) { loadNavigatedPreset (index, kit, samplesDir); } };
+
+    juce::AudioProcessorValueTreeState parameters { *this, nullptr, "Parameters", createParameterLayout() };
+    PadParameters volumeParameters {};
+    PadParameters panParameters {};
+
+    static constexpr int kTriggerEventCapacity = 512;
+
+    juce::AbstractFifo triggerFifo { kTriggerEventCapacity };
+    std::array<TriggerEvent, kTriggerEventCapacity> triggerEvents;
+
+    std::atomic<bool> restoringState { false };
+    juce::MemoryBlock restoringData;   // guarded by restoreMutex
+    std::mutex restoreMutex;
+
+    // getStateInformation hands back its last block until something it saves
+    // changes. Pads and parameters are tracked by version, settings by value.
+    struct SavedStateKey
+    {
+        juce::File samplesDir, presetsDir;
+        int navChannel = 0, prevCC = 0, nextCC = 0, padChannels = 0, programChannel = 0;
+        juce::uint32 controllerActionsVersion = 0;
+        juce::String drumKit;
+        KitLoader::PublishMode kitLoadMode = KitLoader::PublishMode::WholeKit;
+        juce::int64 sampleCacheBytes = 0;
+        int prefetchDepth = 0, streamPreloadMs = 0;
+        bool memoryMapSamples = false;
+        Resampler::Quality resampleQuality = Resampler::Quality::Medium;
+        int maxVoices = 0;
+        SampleEngine::StealPolicy stealPolicy = SampleEngine::StealPolicy::Oldest;
+        int presetIndex = -1;
+        juce::uint32 padStateVersion = 0, parameterVersion = 0;
+
+        bool operator== (const SavedStateKey&) const = default;
+    };
+
+    SavedStateKey makeSavedStateKey();
+
+    std::atomic<juce::uint32> parameterVersion { 0 };
+    std::optional<SavedStateKey> savedStateKey;   // guarded by savedStateMutex
+    juce::MemoryBlock savedState;
+    std::mutex savedStateMutex;
+
+    void schedulePrefetch();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BeatwerkProcessor)
 };
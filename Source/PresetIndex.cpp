@@ -0,0 +1,300 @@
+#include "PresetIndex.h"
+#include "PresetManager.h"
+#include "DkitParser.h"
+#include <algorithm>
+#include <unordered_map>
+
+juce::File PresetIndex::getIndexFile (const juce::File& presetsDir)
+{
+    return presetsDir.getChildFile (".beatwerk-index");
+}
+
+bool PresetIndex::load (const juce::File& presetsDir, const juce::File& samplesDir)
+{
+    entries.clear();
+    indexedPresetsDir = presetsDir;
+    indexedSamplesDir = samplesDir;
+
+    juce::FileInputStream in (getIndexFile (presetsDir));
+    if (! in.openedOk())
+        return false;
+
+    if ((juce::uint32) in.readInt() != kMagic || (juce::uint32) in.readInt() != kVersion
+        || in.readString() != presetsDir.getFullPathName() || in.readString() != samplesDir.getFullPathName())
+        return false;
+
+    int numEntries = in.readCompressedInt();
+    if (numEntries < 0)
+        return false;
+
+    entries.reserve ((size_t) numEntries);
+
+    for (int i = 0; i < numEntries && ! in.isExhausted(); ++i)
+    {
+        Entry entry;
+        entry.file = presetsDir.getChildFile (in.readString());
+        entry.modificationTime = in.readInt64();
+        entry.size = in.readInt64();
+        entry.name = in.readString();
+        entry.author = in.readString();
+        entry.numPads = in.readCompressedInt();
+
+        int numSamplePaths = in.readCompressedInt();
+        for (int p = 0; p < numSamplePaths && ! in.isExhausted(); ++p)
+            entry.samplePaths.add (in.readString());
+
+        entry.missingSamples = in.readBool();
+        entries.push_back (std::move (entry));
+    }
+
+    if ((int) entries.size() != numEntries)
+    {
+        entries.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool PresetIndex::save() const
+{
+    if (! indexedPresetsDir.isDirectory())
+        return false;
+
+    juce::MemoryOutputStream out;
+    out.writeInt ((int) kMagic);
+    out.writeInt ((int) kVersion);
+    out.writeString (indexedPresetsDir.getFullPathName());
+    out.writeString (indexedSamplesDir.getFullPathName());
+    out.writeCompressedInt ((int) entries.size());
+
+    for (auto& entry : entries)
+    {
+        out.writeString (entry.file.getRelativePathFrom (indexedPresetsDir));
+        out.writeInt64 (entry.modificationTime);
+        out.writeInt64 (entry.size);
+        out.writeString (entry.name);
+        out.writeString (entry.author);
+        out.writeCompressedInt (entry.numPads);
+
+        out.writeCompressedInt (entry.samplePaths.size());
+        for (auto& path : entry.samplePaths)
+            out.writeString (path);
+
+        out.writeBool (entry.missingSamples);
+    }
+
+    return getIndexFile (indexedPresetsDir).replaceWithData (out.getData(), out.getDataSize());
+}
+
+bool PresetIndex::update (const juce::File& presetsDir, const juce::File& samplesDir)
+{
+    // Entries indexed against other directories can't be reused
+    std::unordered_map<juce::String, Entry> previous;
+    if (presetsDir == indexedPresetsDir && samplesDir == indexedSamplesDir)
+        for (auto& entry : entries)
+            previous.emplace (entry.file.getFullPathName(), std::move (entry));
+
+    indexedPresetsDir = presetsDir;
+    indexedSamplesDir = samplesDir;
+    entries.clear();
+
+    bool changed = false;
+
+    if (presetsDir.isDirectory())
+    {
+        DkitParser parser;
+
+        for (auto& found : juce::RangedDirectoryIterator (presetsDir, true, "*.dkit", juce::File::findFiles))
+        {
+            auto file = found.getFile();
+            auto modificationTime = found.getModificationTime().toMilliseconds();
+            auto size = found.getFileSize();
+
+            auto it = previous.find (file.getFullPathName());
+            if (it != previous.end() && it->second.modificationTime == modificationTime && it->second.size == size)
+            {
+                entries.push_back (std::move (it->second));
+                previous.erase (it);
+                continue;
+            }
+
+            if (it != previous.end())
+                previous.erase (it);
+
+            auto entry = readPreset (parser, file, samplesDir);
+            entry.modificationTime = modificationTime;
+            entry.size = size;
+            entries.push_back (std::move (entry));
+            changed = true;
+        }
+    }
+
+    return changed || ! previous.empty();
+}
+
+bool PresetIndex::applyChanges (const DirectoryWatcher::ChangeList& changes)
+{
+    using Type = DirectoryWatcher::Change::Type;
+
+    std::unordered_map<juce::String, Entry> byPath;
+    for (auto& entry : entries)
+        byPath.emplace (entry.file.getFullPathName(), std::move (entry));
+
+    auto removeUnder = [&byPath] (const juce::File& dir)
+    {
+        std::vector<Entry> removed;
+        for (auto it = byPath.begin(); it != byPath.end();)
+        {
+            if (it->second.file.isAChildOf (dir))
+            {
+                removed.push_back (std::move (it->second));
+                it = byPath.erase (it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        return removed;
+    };
+
+    DkitParser parser;
+    auto reread = [this, &byPath, &parser] (const juce::File& file)
+    {
+        auto entry = readPreset (parser, file, indexedSamplesDir);
+        entry.modificationTime = file.getLastModificationTime().toMilliseconds();
+        entry.size = file.getSize();
+        byPath[file.getFullPathName()] = std::move (entry);
+    };
+
+    bool changed = false;
+    bool rescan = false;
+
+    for (auto& change : changes)
+    {
+        if (change.type == Type::Reset)
+        {
+            rescan = true;
+            break;
+        }
+
+        if (change.type == Type::Renamed && change.isDirectory)
+        {
+            for (auto& entry : removeUnder (change.previousFile))
+            {
+                entry.file = change.file.getChildFile (entry.file.getRelativePathFrom (change.previousFile));
+                byPath[entry.file.getFullPathName()] = std::move (entry);
+                changed = true;
+            }
+        }
+        else if (change.type == Type::Removed && change.isDirectory)
+        {
+            changed = ! removeUnder (change.file).empty() || changed;
+        }
+        else if (change.type == Type::Renamed)
+        {
+            auto old = byPath.find (change.previousFile.getFullPathName());
+            if (old != byPath.end())
+            {
+                auto entry = std::move (old->second);
+                byPath.erase (old);
+                changed = true;
+
+                if (isPresetFile (change.file))
+                {
+                    entry.file = change.file;
+                    byPath[change.file.getFullPathName()] = std::move (entry);
+                }
+            }
+            else if (isPresetFile (change.file))
+            {
+                reread (change.file);
+                changed = true;
+            }
+        }
+        else if (change.type == Type::Removed)
+        {
+            changed = byPath.erase (change.file.getFullPathName()) > 0 || changed;
+        }
+        else if (! change.isDirectory && isPresetFile (change.file))
+        {
+            reread (change.file);
+            changed = true;
+        }
+    }
+
+    entries.clear();
+    for (auto& [path, entry] : byPath)
+        entries.push_back (std::move (entry));
+
+    if (rescan)
+        return update (indexedPresetsDir, indexedSamplesDir);
+
+    return changed;
+}
+
+bool PresetIndex::applySampleChanges (const DirectoryWatcher::ChangeList& changes)
+{
+    bool reset = std::any_of (changes.begin(), changes.end(), [] (const DirectoryWatcher::Change& change)
+    {
+        return change.type == DirectoryWatcher::Change::Type::Reset;
+    });
+
+    auto isChanged = [&changes] (const juce::File& sample)
+    {
+        for (auto& change : changes)
+            for (auto& changed : { change.file, change.previousFile })
+                if (changed != juce::File() && (sample == changed || sample.isAChildOf (changed)))
+                    return true;
+
+        return false;
+    };
+
+    bool changed = false;
+
+    for (auto& entry : entries)
+    {
+        bool affected = reset;
+        for (int i = 0; i < entry.samplePaths.size() && ! affected; ++i)
+            affected = entry.samplePaths[i].isNotEmpty()
+                         && isChanged (PresetManager::resolveSamplePath (indexedSamplesDir, entry.samplePaths[i]));
+
+        if (! affected)
+            continue;
+
+        bool missing = hasMissingSamples (entry.samplePaths, indexedSamplesDir);
+        if (missing != entry.missingSamples)
+        {
+            entry.missingSamples = missing;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+PresetIndex::Entry PresetIndex::readPreset (DkitParser& parser, const juce::File& file, const juce::File& samplesDir)
+{
+    DkitParser::Summary summary;
+    parser.parseSummary (file, summary);
+
+    Entry entry;
+    entry.file = file;
+    entry.name = summary.name;
+    entry.author = summary.author;
+    entry.numPads = summary.numPads;
+    entry.samplePaths = summary.samplePaths;
+    entry.missingSamples = hasMissingSamples (entry.samplePaths, samplesDir);
+
+    return entry;
+}
+
+bool PresetIndex::hasMissingSamples (const juce::StringArray& samplePaths, const juce::File& samplesDir)
+{
+    for (auto& path : samplePaths)
+        if (path.isNotEmpty() && ! PresetManager::resolveSamplePath (samplesDir, path).existsAsFile())
+            return true;
+
+    return false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include "DirectoryWatcher.h"
+#include <vector>
+
+class DkitParser;
+
+// Metadata for every .dkit file under the presets directory, kept in a
+// flat binary file next to the presets. Rescans walk the directory but
+// only re-read presets whose size or modification time changed.
+class PresetIndex
+{
+public:
+    struct Entry
+    {
+        juce::File file;
+        juce::int64 modificationTime = 0;
+        juce::int64 size = 0;
+        juce::String name;
+        juce::String author;
+        int numPads = 0;
+        juce::StringArray samplePaths;   // as stored in the preset
+        bool missingSamples = false;
+    };
+
+    // Reads the index stored for presetsDir. False if there is none or it
+    // was written for other directories or by another format version.
+    bool load (const juce::File& presetsDir, const juce::File& samplesDir);
+    bool save() const;
+
+    // Brings the entries up to date with the files on disk, returning true
+    // if anything was added, removed or re-read
+    bool update (const juce::File& presetsDir, const juce::File& samplesDir);
+
+    // Applies changes reported by a watcher on the indexed presets folder,
+    // re-reading only the presets they name
+    bool applyChanges (const DirectoryWatcher::ChangeList& changes);
+
+    // Re-checks missingSamples for the presets using the samples named by a
+    // watcher on the samples folder. Returns true if any flag changed.
+    bool applySampleChanges (const DirectoryWatcher::ChangeList& changes);
+
+    const std::vector<Entry>& getEntries() const { return entries; }
+
+    static juce::File getIndexFile (const juce::File& presetsDir);
+
+private:
+    static constexpr juce::uint32 kMagic = 0x58494b42;   // "BKIX"
+    static constexpr juce::uint32 kVersion = 2;
+
+    juce::File indexedPresetsDir;
+    juce::File indexedSamplesDir;
+    std::vector<Entry> entries;
+
+    static Entry readPreset (DkitParser& parser, const juce::File& file, const juce::File& samplesDir);
+    static bool hasMissingSamples (const juce::StringArray& samplePaths, const juce::File& samplesDir);
+    static bool isPresetFile (const juce::File& file) { return file.hasFileExtension ("dkit"); }
+};
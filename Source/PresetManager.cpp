@@ -1,4 +1,6 @@
 #include "PresetManager.h"
+#include "DkitParser.h"
+#include <juce_events/juce_events.h>
 
 PresetManager::PresetManager()
 {
@@ -21,35 +23,162 @@ juce::File PresetManager::getDefaultPresetsDir()
 void PresetManager::setSamplesDir (const juce::File& dir)
 {
     samplesDir = dir;
+    ++scanGeneration;
+    publishSnapshot();
 }
 
 void PresetManager::setPresetsDir (const juce::File& dir)
 {
     presetsDir = dir;
+    ++scanGeneration;
+}
+
+void PresetManager::loadPresetIndex()
+{
+    presetIndex.load (presetsDir, samplesDir);
+    updatePresetList();
 }
 
 void PresetManager::scanForPresets()
 {
-    presets.clear();
+    // Supersedes any background scan still running
+    ++scanGeneration;
+    backgroundScanRunning = false;
+    changesDuringScan.clear();
+    sampleChangesDuringScan.clear();
 
-    if (! presetsDir.isDirectory())
-        return;
+    if (presetIndex.update (presetsDir, samplesDir))
+        presetIndex.save();
 
-    auto dkitFiles = presetsDir.findChildFiles (juce::File::findFiles, true, "*.dkit");
-    dkitFiles.sort();
+    updatePresetList();
+}
 
-    for (auto& f : dkitFiles)
+void PresetManager::scanForPresetsInBackground (std::function<void()> onFinished)
+{
+    int generation = ++scanGeneration;
+    backgroundScanRunning = true;
+    changesDuringScan.clear();
+    sampleChangesDuringScan.clear();
+
+    // The scan works on its own copy of the index
+    juce::Thread::launch ([index = presetIndex, presetsDir = presetsDir, samplesDir = samplesDir,
+                           generation, onFinished = std::move (onFinished), safeThis = weakThis] () mutable
     {
-        PresetEntry entry;
-        entry.name = f.getFileNameWithoutExtension();
-        entry.file = f;
-        presets.push_back (entry);
-    }
+        bool changed = index.update (presetsDir, samplesDir);
+
+        juce::MessageManager::callAsync ([index = std::move (index), changed, generation,
+                                          onFinished = std::move (onFinished), safeThis] () mutable
+        {
+            if (safeThis == nullptr || safeThis->scanGeneration != generation)
+                return;
+
+            safeThis->finishBackgroundScan (std::move (index), changed);
+
+            if (onFinished)
+                onFinished();
+        });
+    });
+}
+
+void PresetManager::finishBackgroundScan (PresetIndex scanned, bool changed)
+{
+    backgroundScanRunning = false;
+    presetIndex = std::move (scanned);
+
+    // The scan may have walked past files the watcher reported meanwhile
+    if (! changesDuringScan.empty())
+        changed = presetIndex.applyChanges (changesDuringScan) || changed;
+
+    if (! sampleChangesDuringScan.empty())
+        changed = presetIndex.applySampleChanges (sampleChangesDuringScan) || changed;
+
+    changesDuringScan.clear();
+    sampleChangesDuringScan.clear();
+
+    if (changed)
+        presetIndex.save();
+
+    updatePresetList();
+}
+
+bool PresetManager::applyFileChanges (const DirectoryWatcher::ChangeList& changes)
+{
+    if (backgroundScanRunning)
+        changesDuringScan.insert (changesDuringScan.end(), changes.begin(), changes.end());
+
+    if (! presetIndex.applyChanges (changes))
+        return false;
+
+    presetIndex.save();
+    updatePresetList();
+    return true;
+}
+
+bool PresetManager::applySampleFileChanges (const DirectoryWatcher::ChangeList& changes)
+{
+    if (backgroundScanRunning)
+        sampleChangesDuringScan.insert (sampleChangesDuringScan.end(), changes.begin(), changes.end());
+
+    if (! presetIndex.applySampleChanges (changes))
+        return false;
+
+    presetIndex.save();
+    updatePresetList();
+    return true;
+}
+
+void PresetManager::updatePresetList()
+{
+    presets.clear();
+    presets.reserve (presetIndex.getEntries().size());
+
+    for (auto& info : presetIndex.getEntries())
+        presets.push_back ({ info.file.getFileNameWithoutExtension(), info });
 
     std::sort (presets.begin(), presets.end(), [] (const PresetEntry& a, const PresetEntry& b)
     {
-        return a.name.compareIgnoreCase (b.name) < 0;
+        if (int order = a.name.compareIgnoreCase (b.name); order != 0)
+            return order < 0;
+        return a.info.file.getFullPathName() < b.info.file.getFullPathName();
     });
+
+    // Keep pointing at the loaded preset wherever it now sorts
+    if (currentIndex >= 0)
+    {
+        auto it = std::find_if (presets.begin(), presets.end(), [this] (const PresetEntry& entry)
+        {
+            return entry.info.file == currentKit.sourceFile;
+        });
+        currentIndex = it != presets.end() ? (int) std::distance (presets.begin(), it) : -1;
+    }
+
+    publishSnapshot();
+}
+
+void PresetManager::publishSnapshot()
+{
+    auto next = std::make_shared<Snapshot>();
+    next->files.reserve (presets.size());
+    for (auto& entry : presets)
+        next->files.push_back (entry.info.file);
+    next->currentIndex = currentIndex;
+    next->samplesDir = samplesDir;
+
+    std::lock_guard<std::mutex> lock (snapshotMutex);
+    snapshot = std::move (next);
+}
+
+std::shared_ptr<const PresetManager::Snapshot> PresetManager::getSnapshot() const
+{
+    std::lock_guard<std::mutex> lock (snapshotMutex);
+    return snapshot;
+}
+
+const PresetIndex::Entry* PresetManager::getPresetInfo (int index) const
+{
+    if (index >= 0 && index < (int) presets.size())
+        return &presets[(size_t) index].info;
+    return nullptr;
 }
 
 int PresetManager::getNumPresets() const
@@ -65,21 +194,46 @@ juce::String PresetManager::getPresetName (int index) const
 }
 
 bool PresetManager::loadPreset (int index)
+{
+    if (! selectPreset (index))
+        return false;
+
+    if (onPresetLoaded)
+        onPresetLoaded (currentKit);
+
+    return true;
+}
+
+bool PresetManager::selectPreset (int index)
 {
     if (index < 0 || index >= (int) presets.size())
         return false;
 
     auto& entry = presets[(size_t) index];
 
-    if (! loadDkitFile (entry.file))
+    if (! loadDkitFile (entry.info.file))
         return false;
 
     currentIndex = index;
+    publishSnapshot();
+    return true;
+}
 
-    if (onPresetLoaded)
-        onPresetLoaded (currentKit);
+void PresetManager::selectPreset (int index, const DkitPreset& kit)
+{
+    // index comes from a snapshot, and the list may have changed since
+    if (getPresetFile (index) != kit.sourceFile)
+    {
+        auto it = std::find_if (presets.begin(), presets.end(), [&kit] (const PresetEntry& entry)
+        {
+            return entry.info.file == kit.sourceFile;
+        });
+        index = it != presets.end() ? (int) std::distance (presets.begin(), it) : -1;
+    }
 
-    return true;
+    currentIndex = index;
+    currentKit = kit;
+    publishSnapshot();
 }
 
 bool PresetManager::loadNextPreset()
@@ -119,35 +273,7 @@ bool PresetManager::loadDkitFile (const juce::File& file)
 DkitPreset PresetManager::parseDkitJson (const juce::File& file)
 {
     DkitPreset preset;
-    preset.sourceFile = file;
-
-    auto jsonText = file.loadFileAsString();
-    auto parsed = juce::JSON::parse (jsonText);
-
-    if (! parsed.isObject())
-        return preset;
-
-    preset.name = parsed.getProperty ("name", "").toString();
-    preset.author = parsed.getProperty ("author", "").toString();
-    preset.description = parsed.getProperty ("description", "").toString();
-    preset.source = parsed.getProperty ("source", "").toString();
-    preset.createdAt = parsed.getProperty ("createdAt", "").toString();
-
-    auto padsArray = parsed.getProperty ("pads", juce::var());
-    if (padsArray.isArray())
-    {
-        for (int i = 0; i < padsArray.size(); ++i)
-        {
-            auto padVar = padsArray[i];
-            DkitPadMapping mapping;
-            mapping.midiNote = (int) padVar.getProperty ("midiNote", -1);
-            mapping.sampleFile = padVar.getProperty ("sampleFile", "").toString();
-            mapping.sampleName = padVar.getProperty ("sampleName", "").toString();
-            if (mapping.midiNote >= 0)
-                preset.pads.push_back (mapping);
-        }
-    }
-
+    DkitParser().parse (file, preset);
     return preset;
 }
 
@@ -168,6 +294,29 @@ bool PresetManager::writeDkitJson (const juce::File& file, const DkitPreset& pre
         padObj->setProperty ("midiNote", pad.midiNote);
         padObj->setProperty ("sampleFile", pad.sampleFile);
         padObj->setProperty ("sampleName", pad.sampleName);
+        if (pad.voices > 0)
+            padObj->setProperty ("voices", pad.voices);
+        if (pad.chokeGroup > 0)
+            padObj->setProperty ("chokeGroup", pad.chokeGroup);
+
+        if (! pad.layers.empty())
+        {
+            juce::Array<juce::var> layersArray;
+            for (auto& layer : pad.layers)
+            {
+                juce::DynamicObject::Ptr layerObj = new juce::DynamicObject();
+                layerObj->setProperty ("velocityLow", layer.velocityLow);
+                layerObj->setProperty ("velocityHigh", layer.velocityHigh);
+
+                juce::Array<juce::var> samplesArray;
+                for (auto& sampleFile : layer.sampleFiles)
+                    samplesArray.add (sampleFile);
+                layerObj->setProperty ("samples", samplesArray);
+
+                layersArray.add (juce::var (layerObj.get()));
+            }
+            padObj->setProperty ("layers", layersArray);
+        }
         padsArray.add (juce::var (padObj.get()));
     }
 
@@ -177,8 +326,7 @@ bool PresetManager::writeDkitJson (const juce::File& file, const DkitPreset& pre
     return file.replaceWithText (jsonText);
 }
 
-bool PresetManager::savePreset (const juce::String& name,
-                                 const std::map<int, juce::File>& padMappings)
+bool PresetManager::savePreset (const juce::String& name, std::vector<DkitPadMapping> pads)
 {
     presetsDir.createDirectory();
 
@@ -187,12 +335,14 @@ bool PresetManager::savePreset (const juce::String& name,
     preset.source = "User created";
     preset.createdAt = juce::Time::getCurrentTime().toISO8601 (true);
 
-    for (auto& [note, sampleFile] : padMappings)
+    for (auto& pad : pads)
     {
-        DkitPadMapping pad;
-        pad.midiNote = note;
-        pad.sampleFile = makeRelativeSamplePath (sampleFile);
-        pad.sampleName = sampleFile.getFileNameWithoutExtension();
+        pad.sampleFile = makeRelativeSamplePath (juce::File (pad.sampleFile));
+
+        for (auto& layer : pad.layers)
+            for (auto& sampleFile : layer.sampleFiles)
+                sampleFile = makeRelativeSamplePath (juce::File (sampleFile));
+
         preset.pads.push_back (pad);
     }
 
@@ -203,7 +353,7 @@ bool PresetManager::savePreset (const juce::String& name,
 juce::File PresetManager::getPresetFile (int index) const
 {
     if (index >= 0 && index < (int) presets.size())
-        return presets[(size_t) index].file;
+        return presets[(size_t) index].info.file;
     return {};
 }
 
@@ -214,7 +364,7 @@ bool PresetManager::deletePreset (int index)
 
     auto& entry = presets[(size_t) index];
 
-    if (! entry.file.deleteFile())
+    if (! entry.info.file.deleteFile())
         return false;
 
     presets.erase (presets.begin() + index);
@@ -234,6 +384,7 @@ bool PresetManager::deletePreset (int index)
         --currentIndex;
     }
 
+    publishSnapshot();
     return true;
 }
 
@@ -246,27 +397,28 @@ bool PresetManager::renamePreset (int index, const juce::String& newName)
         return false;
 
     auto& entry = presets[(size_t) index];
-    auto newFile = entry.file.getParentDirectory().getChildFile (newName + ".dkit");
+    auto newFile = entry.info.file.getParentDirectory().getChildFile (newName + ".dkit");
 
-    if (newFile.existsAsFile() && newFile != entry.file)
+    if (newFile.existsAsFile() && newFile != entry.info.file)
         return false;
 
-    auto preset = parseDkitJson (entry.file);
+    auto preset = parseDkitJson (entry.info.file);
     if (preset.name.isEmpty())
         return false;
 
     preset.name = newName;
-    if (! writeDkitJson (entry.file, preset))
+    if (! writeDkitJson (entry.info.file, preset))
         return false;
 
-    if (newFile != entry.file)
+    if (newFile != entry.info.file)
     {
-        if (! entry.file.moveFileTo (newFile))
+        if (! entry.info.file.moveFileTo (newFile))
             return false;
     }
 
     entry.name = newName;
-    entry.file = newFile;
+    entry.info.file = newFile;
+    entry.info.name = newName;
 
     if (index == currentIndex)
     {
@@ -274,15 +426,21 @@ bool PresetManager::renamePreset (int index, const juce::String& newName)
         currentKit.sourceFile = newFile;
     }
 
+    publishSnapshot();
     return true;
 }
 
 juce::File PresetManager::resolveSamplePath (const juce::String& relativePath) const
+{
+    return resolveSamplePath (samplesDir, relativePath);
+}
+
+juce::File PresetManager::resolveSamplePath (const juce::File& baseDir, const juce::String& relativePath)
 {
     if (relativePath.isEmpty())
         return {};
 
-    return samplesDir.getChildFile (relativePath);
+    return baseDir.getChildFile (relativePath);
 }
 
 juce::String PresetManager::makeRelativeSamplePath (const juce::File& sampleFile)
@@ -1,13 +1,26 @@
 #pragma once
 #include <juce_core/juce_core.h>
+#include "PresetIndex.h"
 #include <vector>
 #include <functional>
+#include <memory>
+#include <mutex>
+
+struct DkitSampleLayer
+{
+    int velocityLow = 1;
+    int velocityHigh = 127;
+    juce::StringArray sampleFiles;   // relative to samplesDir, played round-robin
+};
 
 struct DkitPadMapping
 {
     int midiNote = -1;
     juce::String sampleFile;   // relative to samplesDir
     juce::String sampleName;
+    int voices = 0;            // polyphony, 0 = engine default
+    int chokeGroup = 0;        // 0 = none
+    std::vector<DkitSampleLayer> layers;   // velocity zones, replaces sampleFile when present
 };
 
 struct DkitPreset
@@ -31,20 +44,54 @@ public:
     juce::File getSamplesDir() const { return samplesDir; }
     juce::File getPresetsDir() const { return presetsDir; }
 
+    // Fills the preset list from the index saved by the last scan, without
+    // touching the presets themselves
+    void loadPresetIndex();
+
+    // Rescans the presets directory, re-reading only changed presets
     void scanForPresets();
 
+    // Rescans on a background thread. The list is only ever changed on the
+    // message thread, where the result is swapped in before onFinished.
+    void scanForPresetsInBackground (std::function<void()> onFinished);
+
+    // Updates the list in place from a watcher on the presets directory.
+    // Returns true if the list changed.
+    bool applyFileChanges (const DirectoryWatcher::ChangeList& changes);
+
+    // Updates the presets' missing samples flags from a watcher on the
+    // samples directory. Returns true if the list changed.
+    bool applySampleFileChanges (const DirectoryWatcher::ChangeList& changes);
+
     int getNumPresets() const;
     juce::String getPresetName (int index) const;
+    const PresetIndex::Entry* getPresetInfo (int index) const;
     int getCurrentPresetIndex() const { return currentIndex; }
 
     bool loadPreset (int index);
+
+    // Makes index the current preset without loading its samples
+    bool selectPreset (int index);
+    void selectPreset (int index, const DkitPreset& kit);   // kit already parsed
     bool loadNextPreset();
     bool loadPreviousPreset();
 
     const DkitPreset& getCurrentKit() const { return currentKit; }
 
-    bool savePreset (const juce::String& name,
-                     const std::map<int, juce::File>& padMappings);
+    // Sample paths in pads are absolute; they are stored relative to
+    // samplesDir, copying in files from elsewhere.
+    bool savePreset (const juce::String& name, std::vector<DkitPadMapping> pads);
+
+    // Read-only copy of the list for other threads, replaced whenever the
+    // list, the current preset or the samples directory changes
+    struct Snapshot
+    {
+        std::vector<juce::File> files;
+        int currentIndex = -1;
+        juce::File samplesDir;
+    };
+
+    std::shared_ptr<const Snapshot> getSnapshot() const;
 
     bool deletePreset (int index);
     bool renamePreset (int index, const juce::String& newName);
@@ -56,6 +103,7 @@ public:
     static juce::File getDefaultPresetsDir();
 
     juce::File resolveSamplePath (const juce::String& relativePath) const;
+    static juce::File resolveSamplePath (const juce::File& baseDir, const juce::String& relativePath);
     juce::String makeRelativeSamplePath (const juce::File& sampleFile);
 
     static DkitPreset parseDkitJson (const juce::File& file);
@@ -64,15 +112,30 @@ public:
 private:
     struct PresetEntry
     {
-        juce::String name;
-        juce::File file;
+        juce::String name;   // file name without extension
+        PresetIndex::Entry info;
     };
 
     juce::File samplesDir;
     juce::File presetsDir;
+    PresetIndex presetIndex;
     std::vector<PresetEntry> presets;
     int currentIndex = -1;
     DkitPreset currentKit;
 
+    int scanGeneration = 0;
+    bool backgroundScanRunning = false;
+    DirectoryWatcher::ChangeList changesDuringScan;
+    DirectoryWatcher::ChangeList sampleChangesDuringScan;
+
+    mutable std::mutex snapshotMutex;
+    std::shared_ptr<const Snapshot> snapshot = std::make_shared<const Snapshot>();
+
     bool loadDkitFile (const juce::File& file);
+    void updatePresetList();
+    void publishSnapshot();
+    void finishBackgroundScan (PresetIndex scanned, bool changed);
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (PresetManager)
+    juce::WeakReference<PresetManager> weakThis { this };
 };
@@ -0,0 +1,62 @@
+#include "PresetNavigator.h"
+
+PresetNavigator::PresetNavigator (PresetManager& presets, PresetHandler handler)
+    : juce::Thread ("Beatwerk Preset Navigation"), presetManager (presets), onPresetReady (std::move (handler))
+{
+    startThread (juce::Thread::Priority::normal);
+}
+
+PresetNavigator::~PresetNavigator()
+{
+    signalThreadShouldExit();
+    committed.signal();
+    stopThread (5000);
+}
+
+void PresetNavigator::step (int delta)
+{
+    pendingSteps.fetch_add (delta);
+    notify();
+}
+
+void PresetNavigator::select (int index)
+{
+    pendingSteps.store (0);
+    pendingSelection.store (index);
+    notify();
+}
+
+void PresetNavigator::run()
+{
+    // Sleeps until a press arrives. A press signalled while a preset is
+    // being loaded leaves the event set, so it is picked up straight after.
+    while (! threadShouldExit())
+    {
+        wait (-1);
+
+        int selection = pendingSelection.exchange (kNoSelection);
+        int steps = pendingSteps.exchange (0);
+        auto presets = presetManager.getSnapshot();
+        int numPresets = (int) presets->files.size();
+
+        bool validSelection = juce::isPositiveAndBelow (selection, numPresets);
+        if (numPresets == 0 || (! validSelection && steps == 0))
+            continue;
+
+        int base = validSelection ? selection : presets->currentIndex;
+        if (base < 0)
+            base = steps > 0 ? -1 : 0;
+
+        int target = ((base + steps) % numPresets + numPresets) % numPresets;
+        DkitPreset kit;
+        if (! parser.parse (presets->files[(size_t) target], kit) || kit.name.isEmpty())
+            continue;
+
+        committed.reset();
+        onPresetReady (target, kit, presets->samplesDir);
+
+        // The next target is worked out from this one, so wait for the
+        // message thread to take it. Presses meanwhile keep collapsing.
+        committed.wait (kCommitTimeoutMs);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include "PresetManager.h"
+#include "DkitParser.h"
+#include <atomic>
+#include <functional>
+
+// Loads presets picked by MIDI navigation on its own thread. The audio
+// thread only updates atomics and wakes the thread, so presses that arrive
+// while a kit is being prepared collapse into a single load of the preset
+// they lead to.
+class PresetNavigator : private juce::Thread
+{
+public:
+    // Called on the navigator thread with the parsed preset. It queues the
+    // kit and hands the preset to the message thread, which then calls
+    // presetCommitted() once the preset manager has moved to it.
+    using PresetHandler = std::function<void (int index, const DkitPreset& kit, const juce::File& samplesDir)>;
+
+    PresetNavigator (PresetManager& presets, PresetHandler handler);
+    ~PresetNavigator() override;
+
+    // Audio thread
+    void step (int delta);
+    void select (int index);
+
+    // Message thread
+    void presetCommitted() { committed.signal(); }
+
+private:
+    static constexpr int kNoSelection = -1;
+    static constexpr int kCommitTimeoutMs = 1000;
+
+    PresetManager& presetManager;
+    PresetHandler onPresetReady;
+    DkitParser parser;   // navigator thread only
+
+    std::atomic<int> pendingSteps { 0 };
+    std::atomic<int> pendingSelection { kNoSelection };
+    juce::WaitableEvent committed;
+
+    void run() override;
+};
@@ -0,0 +1,120 @@
+#include "PresetPrefetcher.h"
+
+PresetPrefetcher::PresetPrefetcher (SampleEngine& engine, KitLoader& loader)
+    : juce::Thread ("Beatwerk Preset Prefetch"), sampleEngine (engine), kitLoader (loader)
+{
+    startThread (juce::Thread::Priority::low);
+}
+
+PresetPrefetcher::~PresetPrefetcher()
+{
+    ++generation;
+    stopThread (5000);
+}
+
+void PresetPrefetcher::setDepth (int numNeighbours)
+{
+    depth.store (juce::jlimit (0, kMaxDepth, numNeighbours));
+
+    if (depth.load() == 0)
+        ++generation;
+}
+
+void PresetPrefetcher::prefetch (const juce::Array<juce::File>& presetFiles, RequestBuilder builder)
+{
+    {
+        std::lock_guard<std::mutex> lock (pendingMutex);
+        pendingFiles = presetFiles;
+        pendingBuilder = std::move (builder);
+        ++generation;
+    }
+
+    notify();
+}
+
+void PresetPrefetcher::notePresetLoaded (const juce::File& presetFile)
+{
+    if (depth.load() == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock (pendingMutex);
+    if (warmedPresets.count (presetFile.getFullPathName()) > 0)
+        ++hits;
+    else
+        ++misses;
+}
+
+void PresetPrefetcher::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (-1);
+
+        juce::Array<juce::File> files;
+        RequestBuilder builder;
+        int jobGeneration;
+
+        {
+            std::lock_guard<std::mutex> lock (pendingMutex);
+            files.swapWith (pendingFiles);
+            std::swap (builder, pendingBuilder);
+            jobGeneration = generation.load();
+            warmedPresets.clear();
+        }
+
+        if (builder == nullptr || files.isEmpty())
+            continue;
+
+        // Never compete with the kit the drummer is actually waiting for
+        while (kitLoader.isLoading() && jobGeneration == generation.load() && ! threadShouldExit())
+            wait (20);
+
+        // Leave at least half of the cache to the samples actually in use
+        auto budget = sampleEngine.getSampleCache().getMemoryBudget() / 2;
+        juce::int64 bytesWarmed = 0;
+
+        for (auto& file : files)
+        {
+            if (jobGeneration != generation.load() || threadShouldExit())
+                break;
+
+            if (! warmPreset (file, builder, jobGeneration, bytesWarmed, budget))
+                break;
+
+            std::lock_guard<std::mutex> lock (pendingMutex);
+            if (jobGeneration == generation.load())
+                warmedPresets.insert (file.getFullPathName());
+        }
+    }
+}
+
+bool PresetPrefetcher::warmPreset (const juce::File& presetFile, const RequestBuilder& builder,
+                                   int jobGeneration, juce::int64& bytesWarmed, juce::int64 budget)
+{
+    auto request = builder (presetFile);
+
+    std::vector<juce::File> files;
+    for (auto& pad : request.pads)
+    {
+        if (pad.layers.empty())
+            files.push_back (pad.file);
+
+        for (auto& layer : pad.layers)
+            files.insert (files.end(), layer.files.begin(), layer.files.end());
+    }
+
+    for (auto& file : files)
+    {
+        if (jobGeneration != generation.load() || threadShouldExit())
+            return false;
+
+        // Cached samples are taken as they are; the kit load checks them
+        if (auto sample = sampleEngine.decodeSample (file))
+            bytesWarmed += sample->getMemorySize();
+
+        if (bytesWarmed > budget)
+            return false;
+    }
+
+    return true;
+}
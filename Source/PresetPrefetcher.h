@@ -0,0 +1,55 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include "KitLoader.h"
+#include "SampleEngine.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <set>
+
+// Warms the sample cache with the kits either side of the current preset
+// so MIDI next/previous navigation hits decoded samples instead of disk.
+class PresetPrefetcher : private juce::Thread
+{
+public:
+    using RequestBuilder = std::function<KitLoader::KitRequest (const juce::File& presetFile)>;
+
+    struct Stats
+    {
+        juce::uint64 hits = 0;
+        juce::uint64 misses = 0;
+    };
+
+    PresetPrefetcher (SampleEngine& engine, KitLoader& loader);
+    ~PresetPrefetcher() override;
+
+    void setDepth (int numNeighbours);
+    int getDepth() const { return depth.load(); }
+
+    // Replaces any prefetch still in progress
+    void prefetch (const juce::Array<juce::File>& presetFiles, RequestBuilder builder);
+
+    // Records whether a preset that is about to load was already warmed
+    void notePresetLoaded (const juce::File& presetFile);
+    Stats getStats() const { return { hits.load(), misses.load() }; }
+
+    static constexpr int kMaxDepth = 4;
+
+private:
+    SampleEngine& sampleEngine;
+    KitLoader& kitLoader;
+
+    std::atomic<int> depth { 1 };
+    std::atomic<int> generation { 0 };
+    std::atomic<juce::uint64> hits { 0 };
+    std::atomic<juce::uint64> misses { 0 };
+
+    std::mutex pendingMutex;
+    juce::Array<juce::File> pendingFiles;
+    RequestBuilder pendingBuilder;
+    std::set<juce::String> warmedPresets;
+
+    void run() override;
+    bool warmPreset (const juce::File& presetFile, const RequestBuilder& builder,
+                     int jobGeneration, juce::int64& bytesWarmed, juce::int64 budget);
+};
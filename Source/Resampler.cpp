@@ -0,0 +1,202 @@
+#include "Resampler.h"
+#include <atomic>
+#include <cmath>
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+ #define BEATWERK_SSE 1
+#elif JUCE_ARM && (defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64))
+ #include <arm_neon.h>
+ #define BEATWERK_NEON 1
+#endif
+
+namespace
+{
+    constexpr int kMaxTaps = 64;
+    constexpr int kMinParallelFrames = 65536;
+
+    float dotProduct (const float* a, const float* b, int n) noexcept
+    {
+        int i = 0;
+        float sum = 0.0f;
+
+       #if BEATWERK_SSE
+        auto acc0 = _mm_setzero_ps();
+        auto acc1 = _mm_setzero_ps();
+
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = _mm_add_ps (acc0, _mm_mul_ps (_mm_loadu_ps (a + i), _mm_loadu_ps (b + i)));
+            acc1 = _mm_add_ps (acc1, _mm_mul_ps (_mm_loadu_ps (a + i + 4), _mm_loadu_ps (b + i + 4)));
+        }
+
+        alignas (16) float lanes[4];
+        _mm_store_ps (lanes, _mm_add_ps (acc0, acc1));
+        sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+       #elif BEATWERK_NEON
+        auto acc = vdupq_n_f32 (0.0f);
+
+        for (; i + 4 <= n; i += 4)
+            acc = vmlaq_f32 (acc, vld1q_f32 (a + i), vld1q_f32 (b + i));
+
+        sum = (vgetq_lane_f32 (acc, 0) + vgetq_lane_f32 (acc, 1))
+            + (vgetq_lane_f32 (acc, 2) + vgetq_lane_f32 (acc, 3));
+       #endif
+
+        for (; i < n; ++i)
+            sum += a[i] * b[i];
+
+        return sum;
+    }
+
+    double besselI0 (double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    double sinc (double x)
+    {
+        return std::abs (x) < 1.0e-9 ? 1.0 : std::sin (juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+    }
+}
+
+Resampler::Resampler (double conversionRatio, Quality q)
+    : ratio (conversionRatio), step (1.0 / conversionRatio), quality (q)
+{
+    if (quality == Quality::Medium)
+    {
+        halfTaps = 8;
+        numPhases = 128;
+    }
+    else if (quality == Quality::High)
+    {
+        halfTaps = kMaxTaps / 2;
+        numPhases = 512;
+    }
+
+    numTaps = halfTaps * 2;
+
+    if (quality != Quality::Fast)
+        buildKernel();
+}
+
+void Resampler::buildKernel()
+{
+    // Kaiser-windowed sinc, band-limited to the lower of the two Nyquist rates
+    double cutoff = juce::jmin (1.0, ratio) * (quality == Quality::High ? 0.97 : 0.9);
+    double beta = quality == Quality::High ? 9.0 : 6.0;
+    double norm = besselI0 (beta);
+
+    kernel.assign ((size_t) (numPhases + 1) * (size_t) numTaps, 0.0f);
+
+    for (int phase = 0; phase <= numPhases; ++phase)
+    {
+        double frac = (double) phase / numPhases;
+        auto* row = kernel.data() + (size_t) phase * (size_t) numTaps;
+
+        for (int k = 0; k < numTaps; ++k)
+        {
+            double x = (double) (k - halfTaps + 1) - frac;
+            double w = x / halfTaps;
+            double window = std::abs (w) >= 1.0 ? 0.0 : besselI0 (beta * std::sqrt (1.0 - w * w)) / norm;
+            row[k] = (float) (cutoff * sinc (cutoff * x) * window);
+        }
+    }
+}
+
+void Resampler::process (const float* src, int srcLength, juce::int64 srcOffset,
+                         float* dst, juce::int64 firstOut, int numOut) const
+{
+    if (quality != Quality::Fast)
+    {
+        for (int i = 0; i < numOut; ++i)
+            dst[i] = renderSinc (src, srcLength, srcOffset, (double) (firstOut + i) * step);
+        return;
+    }
+
+    auto sampleAt = [src, srcLength] (juce::int64 index)
+    {
+        return index >= 0 && index < srcLength ? src[index] : 0.0f;
+    };
+
+    for (int i = 0; i < numOut; ++i)
+    {
+        double srcPos = (double) (firstOut + i) * step;
+        auto idx = (juce::int64) srcPos;
+        float frac = (float) (srcPos - (double) idx);
+        auto local = idx - srcOffset;
+        dst[i] = sampleAt (local) * (1.0f - frac) + sampleAt (local + 1) * frac;
+    }
+}
+
+float Resampler::renderSinc (const float* src, int srcLength, juce::int64 srcOffset, double srcPos) const
+{
+    auto idx = (juce::int64) srcPos;
+    double phasePos = (srcPos - (double) idx) * numPhases;
+    int phase = (int) phasePos;
+    float phaseFrac = (float) (phasePos - phase);
+
+    auto* rowA = kernel.data() + (size_t) phase * (size_t) numTaps;
+    auto* rowB = rowA + numTaps;
+
+    auto first = idx - halfTaps + 1 - srcOffset;
+    const float* window = src + first;
+    float padded[kMaxTaps];
+
+    if (first < 0 || first + numTaps > srcLength)
+    {
+        for (int k = 0; k < numTaps; ++k)
+        {
+            auto index = first + k;
+            padded[k] = index >= 0 && index < srcLength ? src[index] : 0.0f;
+        }
+        window = padded;
+    }
+
+    // Interpolating between neighbouring phases keeps the table small
+    float a = dotProduct (window, rowA, numTaps);
+    float b = dotProduct (window, rowB, numTaps);
+    return a + phaseFrac * (b - a);
+}
+
+juce::AudioBuffer<float> Resampler::process (const juce::AudioBuffer<float>& source, int numOutFrames,
+                                             juce::ThreadPool* pool) const
+{
+    int numChannels = source.getNumChannels();
+    juce::AudioBuffer<float> result (numChannels, numOutFrames);
+
+    auto convertChannel = [this, &source, &result, numOutFrames] (int ch)
+    {
+        process (source.getReadPointer (ch), source.getNumSamples(), 0, result.getWritePointer (ch), 0, numOutFrames);
+    };
+
+    if (pool == nullptr || numChannels < 2 || quality == Quality::Fast || numOutFrames < kMinParallelFrames)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            convertChannel (ch);
+        return result;
+    }
+
+    juce::WaitableEvent finished;
+    std::atomic<int> remaining { numChannels - 1 };
+
+    for (int ch = 1; ch < numChannels; ++ch)
+    {
+        pool->addJob ([&convertChannel, &finished, &remaining, ch]
+        {
+            convertChannel (ch);
+            if (--remaining == 0)
+                finished.signal();
+        });
+    }
+
+    convertChannel (0);
+    finished.wait();
+    return result;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <vector>
+
+// Sample-rate converter used when loading and streaming samples. Output
+// frame n is taken at source position n / ratio, so any range of the output
+// can be rendered independently and matches a whole-buffer conversion.
+class Resampler
+{
+public:
+    enum class Quality { Fast, Medium, High };
+
+    Resampler (double ratio, Quality quality);
+
+    // Source frames needed either side of a position
+    int getKernelRadius() const { return halfTaps; }
+
+    // Renders output frames [firstOut, firstOut + numOut). src holds source
+    // frames [srcOffset, srcOffset + srcLength); anything outside is silence.
+    void process (const float* src, int srcLength, juce::int64 srcOffset,
+                  float* dst, juce::int64 firstOut, int numOut) const;
+
+    // Converts every channel of source into numOutFrames frames. Channels of
+    // long samples are converted in parallel on the given pool.
+    juce::AudioBuffer<float> process (const juce::AudioBuffer<float>& source, int numOutFrames,
+                                      juce::ThreadPool* pool) const;
+
+private:
+    double ratio;
+    double step;
+    Quality quality;
+    int halfTaps = 1;
+    int numTaps = 2;
+    int numPhases = 0;
+
+    // numPhases + 1 rows of numTaps coefficients, one per fractional position
+    std::vector<float> kernel;
+
+    void buildKernel();
+    float renderSinc (const float* src, int srcLength, juce::int64 srcOffset, double srcPos) const;
+};
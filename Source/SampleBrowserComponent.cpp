@@ -207,6 +207,26 @@ void SampleTreeItem::scanDirectory()
         addSubItem (new SampleTreeItem (f, owner));
 }
 
+void SampleTreeItem::addChildFile (const juce::File& child)
+{
+    bool isDirectory = child.isDirectory();
+    int index = 0;
+
+    // Folders first, then audio files, each in name order
+    for (; index < getNumSubItems(); ++index)
+    {
+        auto* item = dynamic_cast<SampleTreeItem*> (getSubItem (index));
+        if (item == nullptr)
+            continue;
+
+        bool itemIsDirectory = item->getFile().isDirectory();
+        if (itemIsDirectory != isDirectory ? ! itemIsDirectory : child < item->getFile())
+            break;
+    }
+
+    addSubItem (new SampleTreeItem (child, owner), index);
+}
+
 //==============================================================================
 // SampleBrowserComponent
 //==============================================================================
@@ -580,6 +600,87 @@ void SampleBrowserComponent::refreshAfterChange()
         refresh();
 }
 
+SampleTreeItem* SampleBrowserComponent::findItem (const juce::File& file) const
+{
+    if (rootItem == nullptr || ! file.isAChildOf (samplesDir))
+        return file == samplesDir ? rootItem.get() : nullptr;
+
+    auto* parent = findItem (file.getParentDirectory());
+    if (parent == nullptr)
+        return nullptr;
+
+    for (int i = 0; i < parent->getNumSubItems(); ++i)
+        if (auto* item = dynamic_cast<SampleTreeItem*> (parent->getSubItem (i)); item != nullptr && item->getFile() == file)
+            return item;
+
+    return nullptr;
+}
+
+void SampleBrowserComponent::applyFileChanges (const DirectoryWatcher::ChangeList& changes)
+{
+    if (rootItem == nullptr)
+        return;
+
+    using Type = DirectoryWatcher::Change::Type;
+
+    // Search results are a flat list of matching files under the root
+    auto searchText = searchField.getText().trim().toLowerCase();
+    bool searching = searchText.isNotEmpty();
+
+    auto findSearchResult = [this] (const juce::File& file) -> SampleTreeItem*
+    {
+        for (int i = 0; i < rootItem->getNumSubItems(); ++i)
+            if (auto* item = dynamic_cast<SampleTreeItem*> (rootItem->getSubItem (i)); item != nullptr && item->getFile() == file)
+                return item;
+        return nullptr;
+    };
+
+    auto removeFile = [&] (const juce::File& file)
+    {
+        if (auto* item = searching ? findSearchResult (file) : findItem (file))
+            if (auto* parent = item->getParentItem())
+                parent->removeSubItem (item->getIndexInParent());
+    };
+
+    auto addFile = [&] (const juce::File& file, bool isDirectory)
+    {
+        if (! isDirectory && ! SampleTreeItem::isAudioFile (file))
+            return;
+
+        if (searching)
+        {
+            if (! isDirectory && findSearchResult (file) == nullptr
+                && file.getFileNameWithoutExtension().toLowerCase().contains (searchText))
+                rootItem->addSubItem (new SampleTreeItem (file, *this));
+            return;
+        }
+
+        // Folders not opened yet pick up their contents when they are
+        auto* parent = findItem (file.getParentDirectory());
+        if (parent != nullptr && parent->isScanned() && findItem (file) == nullptr)
+            parent->addChildFile (file);
+    };
+
+    for (auto& change : changes)
+    {
+        // Results under a moved or deleted folder can't be found by path
+        if (change.type == Type::Reset
+            || (searching && change.isDirectory && (change.type == Type::Removed || change.type == Type::Renamed)))
+        {
+            refreshAfterChange();
+            return;
+        }
+
+        if (change.type == Type::Removed)
+            removeFile (change.file);
+        else if (change.type == Type::Renamed)
+            removeFile (change.previousFile);
+
+        if (change.type == Type::Added || change.type == Type::Renamed)
+            addFile (change.file, change.isDirectory);
+    }
+}
+
 //==============================================================================
 // Context menu, delete, move
 //==============================================================================
@@ -1,6 +1,7 @@
 #pragma once
 #include <juce_gui_extra/juce_gui_extra.h>
 #include "SampleEngine.h"
+#include "DirectoryWatcher.h"
 #include "LookAndFeel.h"
 
 class SampleBrowserComponent;
@@ -25,6 +26,10 @@ public:
     juce::String getDisplayName() const;
     static bool isAudioFile (const juce::File& f);
     void markAsScanned() { hasScanned = true; }
+    bool isScanned() const { return hasScanned; }
+
+    // Inserts a child where scanDirectory would have put it
+    void addChildFile (const juce::File& child);
 
 private:
     juce::File file;
@@ -55,6 +60,9 @@ public:
     void refresh();
     void revealFile (const juce::File& file);
 
+    // Changes reported by the processor's watcher on the samples folder
+    void applyFileChanges (const DirectoryWatcher::ChangeList& changes);
+
     bool isInterestedInFileDrag (const juce::StringArray& files) override;
     void fileDragEnter (const juce::StringArray& files, int x, int y) override;
     void fileDragMove (const juce::StringArray& files, int x, int y) override;
@@ -87,6 +95,7 @@ private:
     void updateDropTargetHighlight (int x, int y);
     void performSearch();
     void refreshAfterChange();
+    SampleTreeItem* findItem (const juce::File& file) const;
     void deleteItem (const juce::File& file);
     void moveItem (const juce::File& source, const juce::File& targetDir);
     juce::Array<juce::File> collectTargetFolders (const juce::File& excludeItem) const;
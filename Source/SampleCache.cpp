@@ -0,0 +1,156 @@
+#include "SampleCache.h"
+
+SampleCache::SampleCache() {}
+
+juce::String SampleCache::makeKey (const juce::File& file, double sampleRate)
+{
+    return file.getFullPathName() + "|" + juce::String (juce::roundToInt (sampleRate));
+}
+
+SampleData::Ptr SampleCache::find (const juce::File& file, double sampleRate)
+{
+    auto key = makeKey (file, sampleRate);
+
+    std::lock_guard<std::mutex> lock (cacheMutex);
+    auto it = index.find (key);
+    if (it == index.end())
+    {
+        ++misses;
+        return nullptr;
+    }
+
+    ++hits;
+    entries.splice (entries.begin(), entries, it->second);
+    return it->second->sample;
+}
+
+SampleData::Ptr SampleCache::add (const juce::File& file, double sampleRate, const SampleData::Ptr& sample)
+{
+    if (sample == nullptr)
+        return sample;
+
+    auto key = makeKey (file, sampleRate);
+    auto bytes = sample->getMemorySize();
+    auto budget = budgetBytes.load();
+    auto modificationTime = file.getLastModificationTime().toMilliseconds();
+    bool mapped = sample->mappedReader != nullptr;
+
+    std::lock_guard<std::mutex> lock (cacheMutex);
+
+    auto existing = index.find (key);
+    if (existing != index.end())
+    {
+        entries.splice (entries.begin(), entries, existing->second);
+        return existing->second->sample;
+    }
+
+    if (bytes > budget)
+        return sample;
+
+    evictToBudget (budget - bytes);
+
+    if (mapped && numMapped >= kMaxMappedEntries)
+        evictOldestMapped();
+
+    entries.push_front ({ key, sample, bytes, modificationTime, mapped });
+    index[key] = entries.begin();
+    bytesUsed += bytes;
+    numMapped += mapped ? 1 : 0;
+    return sample;
+}
+
+template <typename Predicate>
+void SampleCache::removeWithKeyPrefix (const juce::String& prefix, Predicate&& shouldRemove)
+{
+    for (auto it = index.lower_bound (prefix); it != index.end() && it->first.startsWith (prefix);)
+    {
+        auto entry = (it++)->second;
+        if (shouldRemove (*entry))
+            remove (entry);
+    }
+}
+
+bool SampleCache::validate (const juce::File& file)
+{
+    bool exists = file.existsAsFile();
+    auto modificationTime = exists ? file.getLastModificationTime().toMilliseconds() : 0;
+
+    std::lock_guard<std::mutex> lock (cacheMutex);
+    removeWithKeyPrefix (file.getFullPathName() + "|", [&] (const Entry& entry)
+    {
+        return entry.modificationTime != modificationTime;
+    });
+
+    return exists;
+}
+
+void SampleCache::invalidate (const juce::File& fileOrFolder)
+{
+    auto path = fileOrFolder.getFullPathName();
+    auto all = [] (const Entry&) { return true; };
+
+    std::lock_guard<std::mutex> lock (cacheMutex);
+    removeWithKeyPrefix (path + "|", all);
+    removeWithKeyPrefix (path + juce::File::getSeparatorString(), all);
+}
+
+void SampleCache::setMemoryBudget (juce::int64 bytes)
+{
+    budgetBytes.store (juce::jmax ((juce::int64) 0, bytes));
+
+    std::lock_guard<std::mutex> lock (cacheMutex);
+    evictToBudget (budgetBytes.load());
+}
+
+void SampleCache::evictToBudget (juce::int64 budget)
+{
+    while (bytesUsed > budget && ! entries.empty())
+    {
+        remove (std::prev (entries.end()));
+        ++evictions;
+    }
+}
+
+void SampleCache::evictOldestMapped()
+{
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+    {
+        if (it->mapped)
+        {
+            remove (std::prev (it.base()));
+            ++evictions;
+            return;
+        }
+    }
+}
+
+void SampleCache::remove (std::list<Entry>::iterator entry)
+{
+    bytesUsed -= entry->bytes;
+    numMapped -= entry->mapped ? 1 : 0;
+    index.erase (entry->key);
+    entries.erase (entry);
+}
+
+void SampleCache::clear()
+{
+    std::lock_guard<std::mutex> lock (cacheMutex);
+    entries.clear();
+    index.clear();
+    bytesUsed = 0;
+    numMapped = 0;
+}
+
+SampleCache::Stats SampleCache::getStats() const
+{
+    Stats stats;
+    stats.bytesBudget = budgetBytes.load();
+    stats.hits = hits.load();
+    stats.misses = misses.load();
+    stats.evictions = evictions.load();
+
+    std::lock_guard<std::mutex> lock (cacheMutex);
+    stats.bytesUsed = bytesUsed;
+    stats.numEntries = (int) entries.size();
+    return stats;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "SampleData.h"
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+
+// LRU cache of decoded samples keyed by file and the sample rate they were
+// converted to, so kits sharing samples skip decoding. Lookups never touch
+// the disk; entries are checked against their file once per kit load and
+// dropped when the samples watcher reports a change.
+class SampleCache
+{
+public:
+    struct Stats
+    {
+        juce::int64 bytesUsed = 0;
+        juce::int64 bytesBudget = 0;
+        int numEntries = 0;
+        juce::uint64 hits = 0;
+        juce::uint64 misses = 0;
+        juce::uint64 evictions = 0;
+    };
+
+    SampleCache();
+
+    SampleData::Ptr find (const juce::File& file, double sampleRate);
+
+    // Returns the cached sample if another thread added the same key first
+    SampleData::Ptr add (const juce::File& file, double sampleRate, const SampleData::Ptr& sample);
+
+    // Drops the entries for file if it changed on disk since it was cached.
+    // Returns false if the file no longer exists.
+    bool validate (const juce::File& file);
+
+    // Drops the entries for file, or for everything inside it if it is a folder
+    void invalidate (const juce::File& fileOrFolder);
+
+    void setMemoryBudget (juce::int64 bytes);
+    juce::int64 getMemoryBudget() const { return budgetBytes.load(); }
+
+    void clear();
+    Stats getStats() const;
+
+    static constexpr juce::int64 kDefaultBudgetBytes = (juce::int64) 512 * 1024 * 1024;
+
+    // Each mapped sample holds an open file and a mapping, so their number
+    // is capped on top of the memory budget
+    static constexpr int kMaxMappedEntries = 256;
+
+private:
+    struct Entry
+    {
+        juce::String key;
+        SampleData::Ptr sample;
+        juce::int64 bytes = 0;
+        juce::int64 modificationTime = 0;
+        bool mapped = false;
+    };
+
+    std::list<Entry> entries;   // most recently used first
+    std::map<juce::String, std::list<Entry>::iterator> index;
+    juce::int64 bytesUsed = 0;
+    int numMapped = 0;
+    std::atomic<juce::int64> budgetBytes { kDefaultBudgetBytes };
+
+    std::atomic<juce::uint64> hits { 0 };
+    std::atomic<juce::uint64> misses { 0 };
+    std::atomic<juce::uint64> evictions { 0 };
+
+    mutable std::mutex cacheMutex;
+
+    static juce::String makeKey (const juce::File& file, double sampleRate);
+    void evictToBudget (juce::int64 budget);
+    void evictOldestMapped();
+    void remove (std::list<Entry>::iterator entry);
+
+    // Keys start with the file's full path, so a file's entries, or a
+    // folder's, are one contiguous run of the index
+    template <typename Predicate>
+    void removeWithKeyPrefix (const juce::String& prefix, Predicate&& shouldRemove);
+};
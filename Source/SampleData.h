@@ -0,0 +1,44 @@
+#pragma once
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "Resampler.h"
+#include <memory>
+
+// Decoded sample, immutable once published. Shared by the engine's slot
+// tables, ringing voices and the sample cache; only freed on the reclaim thread.
+struct SampleData : public juce::ReferenceCountedObject
+{
+    using Ptr = juce::ReferenceCountedObjectPtr<SampleData>;
+
+    juce::AudioBuffer<float> buffer;
+    juce::String name;
+    juce::File file;
+    bool missing = false;
+
+    // Streamed samples keep only their head in buffer; the remaining frames
+    // up to lengthInFrames are read from file by the DiskStreamer.
+    bool streamed = false;
+    juce::int64 lengthInFrames = 0;
+    double fileSampleRate = 0.0;
+    double engineSampleRate = 0.0;
+    Resampler::Quality resampleQuality = Resampler::Quality::Fast;
+
+    // Memory-mapped samples have an empty buffer; the render loop converts
+    // their frames straight from the mapped file.
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader;
+
+    int getNumChannels() const
+    {
+        return mappedReader != nullptr ? (int) mappedReader->numChannels : buffer.getNumChannels();
+    }
+
+    // For mapped samples, the size of the mapping
+    juce::int64 getMemorySize() const
+    {
+        if (mappedReader != nullptr)
+            return mappedReader->lengthInSamples * (juce::int64) mappedReader->numChannels
+                     * (juce::int64) (mappedReader->bitsPerSample / 8);
+
+        return (juce::int64) buffer.getNumChannels() * buffer.getNumSamples() * (juce::int64) sizeof (float);
+    }
+};
@@ -1,20 +1,209 @@
 #include "SampleEngine.h"
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // 4-point Hermite interpolation between x0 and x1
+    inline float hermite (float xm1, float x0, float x1, float x2, float t) noexcept
+    {
+        float c1 = 0.5f * (x1 - xm1);
+        float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        return ((c3 * t + c2) * t + c1) * t + x0;
+    }
+
+    inline float tuneToRate (float semitones) noexcept
+    {
+        return semitones == 0.0f ? 1.0f : std::exp2 (semitones / 12.0f);
+    }
+}
 
 SampleEngine::SampleEngine()
 {
     formatManager.registerBasicFormats();
+
+    ownedLiveTable = std::make_unique<SlotTable>();
+    liveTable.store (ownedLiveTable.get());
+
+    reclaimThread.startThread (juce::Thread::Priority::low);
+}
+
+SampleEngine::~SampleEngine()
+{
+    reclaimThread.stopThread (2000);
 }
 
-void SampleEngine::prepareToPlay (double sampleRate, int /*samplesPerBlock*/)
+void SampleEngine::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     currentSampleRate = sampleRate;
+    streamScratch.setSize (DiskStreamer::kMaxChannels, juce::jmax (512, samplesPerBlock));
+    varispeedScratch.setSize (DiskStreamer::kMaxChannels, juce::jmax (512, samplesPerBlock));
+
+    fadeOutFrames = juce::jmax (1, juce::roundToInt (sampleRate * 0.005));
+
+    releaseAllVoices();
+    voices.samples.resize (kVoicePoolSize);
+    voices.positions.resize (kVoicePoolSize);
+    voices.rates.resize (kVoicePoolSize);
+    voices.ages.resize (kVoicePoolSize);
+    voices.velocities.resize (kVoicePoolSize);
+    voices.streams.assign (kVoicePoolSize, -1);
+    voices.notes.resize (kVoicePoolSize);
+    voices.fades.assign (kVoicePoolSize, 0);
+    voices.levels.resize (kVoicePoolSize);
+    voices.gains.resize (kVoicePoolSize);
+    voices.active.reserve (kVoicePoolSize);
+    voices.free.reserve (kVoicePoolSize);
+
+    voices.free.clear();
+    for (int v = kVoicePoolSize; --v >= 0;)
+        voices.free.push_back (v);
+
+    audioRunning.store (true);
 }
 
 void SampleEngine::releaseResources()
 {
-    for (auto& slot : slots)
-        for (auto& voice : slot.voices)
-            voice.active.store (false);
+    audioRunning.store (false);
+    releaseAllVoices();
+}
+
+void SampleEngine::setStreamingPreloadMs (int preloadMs)
+{
+    if (streamingPreloadMs.exchange (juce::jmax (0, preloadMs)) != preloadMs)
+        sampleCache.clear();
+}
+
+void SampleEngine::setMemoryMappingEnabled (bool shouldMap)
+{
+    if (memoryMapping.exchange (shouldMap) != shouldMap)
+        sampleCache.clear();
+}
+
+void SampleEngine::setResampleQuality (Resampler::Quality quality)
+{
+    if (resampleQuality.exchange (quality) != quality)
+        sampleCache.clear();
+}
+
+SampleEngine::SampleData::Ptr SampleEngine::decodeSample (const juce::File& file)
+{
+    double targetRate = currentSampleRate.load();
+
+    if (auto cached = sampleCache.find (file, targetRate))
+        return cached;
+
+    if (memoryMapping.load())
+        if (auto mapped = mapSample (file, targetRate))
+            return addToPool (file, targetRate, mapped);
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+    if (reader == nullptr)
+        return nullptr;
+
+    // Long samples are streamed: only their head is decoded here. The head
+    // and the DiskStreamer convert with the same kernel at the same absolute
+    // positions, so playback crosses over without a seam.
+    double ratio = targetRate > 0 ? targetRate / reader->sampleRate : 1.0;
+    bool needsResampling = reader->sampleRate != targetRate && targetRate > 0;
+    auto quality = resampleQuality.load();
+    Resampler resampler (ratio, needsResampling ? quality : Resampler::Quality::Fast);
+
+    auto lengthInFrames = (juce::int64) ((double) reader->lengthInSamples * ratio);
+    auto preloadFrames = (juce::int64) (streamingPreloadMs.load() * 0.001 * targetRate);
+    bool streamed = preloadFrames > 0
+                    && reader->numChannels <= (unsigned int) DiskStreamer::kMaxChannels
+                    && lengthInFrames > preloadFrames * 2;
+
+    auto framesToRead = streamed ? juce::jmin (reader->lengthInSamples,
+                                               (juce::int64) ((double) preloadFrames / ratio) + resampler.getKernelRadius() + 2)
+                                 : reader->lengthInSamples;
+
+    juce::AudioBuffer<float> newBuffer ((int) reader->numChannels, (int) framesToRead);
+    reader->read (&newBuffer, 0, (int) framesToRead, 0, true, true);
+
+    if (needsResampling)
+        newBuffer = resampler.process (newBuffer, (int) (streamed ? preloadFrames : lengthInFrames), &conversionPool);
+    else if (streamed)
+        newBuffer.setSize (newBuffer.getNumChannels(), (int) preloadFrames, true);
+
+    SampleData::Ptr data = new SampleData();
+    data->buffer = std::move (newBuffer);
+    data->name = file.getFileNameWithoutExtension();
+    data->file = file;
+    data->streamed = streamed;
+    data->lengthInFrames = streamed ? lengthInFrames : data->buffer.getNumSamples();
+    data->fileSampleRate = reader->sampleRate;
+    data->engineSampleRate = targetRate > 0 ? targetRate : reader->sampleRate;
+    data->resampleQuality = quality;
+
+    return addToPool (file, targetRate, data);
+}
+
+SampleEngine::SampleData::Ptr SampleEngine::mapSample (const juce::File& file, double targetRate)
+{
+    auto* format = formatManager.findFormatForFileExtension (file.getFileExtension());
+    if (format == nullptr)
+        return nullptr;
+
+    // Only formats with a mapped reader (PCM WAV/AIFF) and no resampling
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (file));
+    if (mapped == nullptr
+        || mapped->numChannels > (unsigned int) DiskStreamer::kMaxChannels
+        || (targetRate > 0 && mapped->sampleRate != targetRate)
+        || ! mapped->mapEntireFile())
+        return nullptr;
+
+    // Pull the file into the page cache here so the first hits don't wait on
+    // the disk. The pages are not locked: under memory pressure the kernel can
+    // drop them and the audio thread faults them back in. 512 frames is at
+    // most one 4 KB page for stereo 32-bit files.
+    for (juce::int64 frame = 0; frame < mapped->lengthInSamples; frame += 512)
+        mapped->touchSample (frame);
+
+    SampleData::Ptr data = new SampleData();
+    data->name = file.getFileNameWithoutExtension();
+    data->file = file;
+    data->lengthInFrames = mapped->lengthInSamples;
+    data->fileSampleRate = mapped->sampleRate;
+    data->engineSampleRate = mapped->sampleRate;
+    data->mappedReader = std::move (mapped);
+    return data;
+}
+
+SampleEngine::SampleData::Ptr SampleEngine::addToPool (const juce::File& file, double targetRate, SampleData::Ptr data)
+{
+    {
+        std::lock_guard<std::mutex> lock (tableMutex);
+        samplePool.add (data);
+    }
+
+    return sampleCache.add (file, targetRate, data);
+}
+
+template <typename Modifier>
+void SampleEngine::updateTable (Modifier&& modify)
+{
+    std::lock_guard<std::mutex> lock (tableMutex);
+
+    auto next = std::make_unique<SlotTable> (*ownedLiveTable);
+    modify (*next);
+
+    liveTable.store (next.get());
+    ownedLiveTable->retiredAtBlock = renderedBlocks.load();
+    retiredTables.push_back (std::move (ownedLiveTable));
+    ownedLiveTable = std::move (next);
+    ++padStateVersion;
+}
+
+SampleEngine::SampleData::Ptr SampleEngine::getSample (int midiNote) const
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock (tableMutex);
+    return ownedLiveTable->samples[(size_t) midiNote];
 }
 
 void SampleEngine::loadSample (int midiNote, const juce::File& file)
@@ -22,53 +211,124 @@ void SampleEngine::loadSample (int midiNote, const juce::File& file)
     if (midiNote < 0 || midiNote >= kTotalSlots)
         return;
 
-    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
-    if (reader == nullptr)
+    if (! sampleCache.validate (file))
         return;
 
-    juce::AudioBuffer<float> newBuffer ((int) reader->numChannels, (int) reader->lengthInSamples);
-    reader->read (&newBuffer, 0, (int) reader->lengthInSamples, 0, true, true);
+    auto data = decodeSample (file);
+    if (data == nullptr)
+        return;
+
+    publishSample (midiNote, data);
+}
 
-    // Resample if needed
-    if (reader->sampleRate != currentSampleRate && currentSampleRate > 0)
+void SampleEngine::publishSample (int midiNote, const SampleData::Ptr& sample)
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return;
+
+    updateTable ([&] (SlotTable& table)
     {
-        double ratio = currentSampleRate / reader->sampleRate;
-        int newLength = (int) (newBuffer.getNumSamples() * ratio);
-        juce::AudioBuffer<float> resampled (newBuffer.getNumChannels(), newLength);
+        table.samples[(size_t) midiNote] = sample;
+        table.layers[(size_t) midiNote] = nullptr;
+    });
+}
+
+void SampleEngine::publishPad (const PadSample& pad)
+{
+    if (pad.midiNote < 0 || pad.midiNote >= kTotalSlots)
+        return;
 
-        for (int ch = 0; ch < newBuffer.getNumChannels(); ++ch)
+    auto layers = makePadLayers (pad.layers);
+
+    updateTable ([&] (SlotTable& table)
+    {
+        table.samples[(size_t) pad.midiNote] = pad.sample;
+        table.layers[(size_t) pad.midiNote] = layers;
+    });
+}
+
+void SampleEngine::publishKit (const std::vector<PadSample>& pads)
+{
+    std::vector<std::shared_ptr<const PadLayers>> layers;
+    for (auto& pad : pads)
+        layers.push_back (makePadLayers (pad.layers));
+
+    updateTable ([&] (SlotTable& table)
+    {
+        table.samples.fill (nullptr);
+        table.layers.fill (nullptr);
+
+        for (size_t i = 0; i < pads.size(); ++i)
         {
-            auto* src = newBuffer.getReadPointer (ch);
-            auto* dst = resampled.getWritePointer (ch);
-            for (int i = 0; i < newLength; ++i)
+            if (pads[i].midiNote >= 0 && pads[i].midiNote < kTotalSlots)
             {
-                double srcPos = i / ratio;
-                int idx = (int) srcPos;
-                float frac = (float) (srcPos - idx);
-                if (idx + 1 < newBuffer.getNumSamples())
-                    dst[i] = src[idx] * (1.0f - frac) + src[idx + 1] * frac;
-                else if (idx < newBuffer.getNumSamples())
-                    dst[i] = src[idx];
-                else
-                    dst[i] = 0.0f;
+                table.samples[(size_t) pads[i].midiNote] = pads[i].sample;
+                table.layers[(size_t) pads[i].midiNote] = layers[i];
             }
         }
-        newBuffer = std::move (resampled);
-    }
+    });
+
+    for (auto& slot : slots)
+        slot.reset();
+    ++padStateVersion;
+}
+
+// Single-layer pads with one sample need no lookup and get nullptr
+std::shared_ptr<const SampleEngine::PadLayers> SampleEngine::makePadLayers (const std::vector<SampleLayer>& layers)
+{
+    if (layers.empty() || (layers.size() == 1 && layers[0].roundRobin.size() <= 1))
+        return nullptr;
+
+    auto result = std::make_shared<PadLayers>();
+    result->zoneForVelocity.fill (-1);
 
+    for (auto& layer : layers)
     {
-        std::lock_guard<std::mutex> lock (loadMutex);
-        auto& slot = slots[(size_t) midiNote];
+        if (layer.roundRobin.empty() || (int) result->zones.size() >= kMaxVelocityZones)
+            continue;
+
+        PadLayers::Zone zone;
+        zone.velocityLow = juce::jlimit (1, 127, layer.velocityLow);
+        zone.velocityHigh = juce::jlimit (zone.velocityLow, 127, layer.velocityHigh);
+        zone.first = (int) result->samples.size();
+        zone.count = (int) layer.roundRobin.size();
+
+        for (auto& sample : layer.roundRobin)
+            result->samples.push_back (sample);
+
+        // Earlier zones win where ranges overlap
+        auto zoneIndex = (juce::int8) result->zones.size();
+        for (int velocity = zone.velocityLow; velocity <= zone.velocityHigh; ++velocity)
+            if (result->zoneForVelocity[(size_t) velocity] < 0)
+                result->zoneForVelocity[(size_t) velocity] = zoneIndex;
+
+        result->zones.push_back (zone);
+    }
 
-        for (auto& voice : slot.voices)
-            voice.active.store (false);
+    return result;
+}
+
+std::vector<SampleEngine::SampleLayer> SampleEngine::getPadLayers (int midiNote) const
+{
+    std::vector<SampleLayer> result;
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return result;
 
-        slot.buffer = std::move (newBuffer);
-        slot.sampleName = file.getFileNameWithoutExtension();
-        slot.sampleFile = file;
-        slot.loaded = true;
-        slot.missing = false;
+    std::lock_guard<std::mutex> lock (tableMutex);
+    if (auto& layers = ownedLiveTable->layers[(size_t) midiNote])
+    {
+        for (auto& zone : layers->zones)
+        {
+            SampleLayer layer;
+            layer.velocityLow = zone.velocityLow;
+            layer.velocityHigh = zone.velocityHigh;
+            layer.roundRobin.assign (layers->samples.begin() + zone.first,
+                                     layers->samples.begin() + zone.first + zone.count);
+            result.push_back (std::move (layer));
+        }
     }
+
+    return result;
 }
 
 void SampleEngine::clearSample (int midiNote)
@@ -76,16 +336,13 @@ void SampleEngine::clearSample (int midiNote)
     if (midiNote < 0 || midiNote >= kTotalSlots)
         return;
 
-    std::lock_guard<std::mutex> lock (loadMutex);
-    auto& slot = slots[(size_t) midiNote];
-    for (auto& voice : slot.voices)
-        voice.active.store (false);
-    slot.buffer.setSize (0, 0);
-    slot.sampleName.clear();
-    slot.sampleFile = juce::File();
-    slot.loaded = false;
-    slot.missing = false;
-    slot.volume = 1.0f;
+    updateTable ([&] (SlotTable& table)
+    {
+        table.samples[(size_t) midiNote] = nullptr;
+        table.layers[(size_t) midiNote] = nullptr;
+    });
+    slots[(size_t) midiNote].reset();
+    ++padStateVersion;
 }
 
 void SampleEngine::swapSamples (int noteA, int noteB)
@@ -93,128 +350,623 @@ void SampleEngine::swapSamples (int noteA, int noteB)
     if (noteA < 0 || noteA >= kTotalSlots || noteB < 0 || noteB >= kTotalSlots || noteA == noteB)
         return;
 
-    std::lock_guard<std::mutex> lock (loadMutex);
+    updateTable ([&] (SlotTable& table)
+    {
+        std::swap (table.samples[(size_t) noteA], table.samples[(size_t) noteB]);
+        std::swap (table.layers[(size_t) noteA], table.layers[(size_t) noteB]);
+    });
+
+    slots[(size_t) noteA].swapWith (slots[(size_t) noteB]);
+    ++padStateVersion;
+}
 
-    auto& slotA = slots[(size_t) noteA];
-    auto& slotB = slots[(size_t) noteB];
+void SampleEngine::SampleSlot::reset()
+{
+    volume.store (1.0f);
+    pan.store (0.0f);
+    tune.store (0.0f);
+    attackMs.store (0.0f);
+    holdMs.store (0.0f);
+    decayMs.store (0.0f);
+    polyphony.store (kDefaultPadPolyphony);
+    chokeGroup.store (0);
+    output.store (0);
+}
 
-    for (auto& v : slotA.voices)
-        v.active.store (false);
-    for (auto& v : slotB.voices)
-        v.active.store (false);
+void SampleEngine::SampleSlot::swapWith (SampleSlot& other)
+{
+    auto swapValue = [] (auto& a, auto& b) { a.store (b.exchange (a.load())); };
 
-    std::swap (slotA.buffer, slotB.buffer);
-    std::swap (slotA.sampleName, slotB.sampleName);
-    std::swap (slotA.sampleFile, slotB.sampleFile);
-    std::swap (slotA.loaded, slotB.loaded);
-    std::swap (slotA.missing, slotB.missing);
-    std::swap (slotA.volume, slotB.volume);
+    swapValue (volume, other.volume);
+    swapValue (pan, other.pan);
+    swapValue (tune, other.tune);
+    swapValue (attackMs, other.attackMs);
+    swapValue (holdMs, other.holdMs);
+    swapValue (decayMs, other.decayMs);
+    swapValue (polyphony, other.polyphony);
+    swapValue (chokeGroup, other.chokeGroup);
+    swapValue (output, other.output);
 }
 
 bool SampleEngine::hasSample (int midiNote) const
 {
-    if (midiNote < 0 || midiNote >= kTotalSlots)
-        return false;
-    return slots[(size_t) midiNote].loaded;
+    auto sample = getSample (midiNote);
+    return sample != nullptr && ! sample->missing;
 }
 
 juce::String SampleEngine::getSampleName (int midiNote) const
 {
-    if (midiNote < 0 || midiNote >= kTotalSlots)
-        return {};
-    return slots[(size_t) midiNote].sampleName;
+    if (auto sample = getSample (midiNote))
+        return sample->name;
+    return {};
 }
 
 juce::File SampleEngine::getSampleFile (int midiNote) const
 {
-    if (midiNote < 0 || midiNote >= kTotalSlots)
-        return {};
-    return slots[(size_t) midiNote].sampleFile;
+    if (auto sample = getSample (midiNote))
+        return sample->file;
+    return {};
 }
 
 void SampleEngine::setPadVolume (int midiNote, float volume)
 {
     if (midiNote < 0 || midiNote >= kTotalSlots)
         return;
-    slots[(size_t) midiNote].volume = juce::jlimit (0.0f, 2.0f, volume);
+    slots[(size_t) midiNote].volume.store (juce::jlimit (0.0f, 2.0f, volume));
 }
 
 float SampleEngine::getPadVolume (int midiNote) const
 {
     if (midiNote < 0 || midiNote >= kTotalSlots)
         return 1.0f;
-    return slots[(size_t) midiNote].volume;
+    return slots[(size_t) midiNote].volume.load();
 }
 
-void SampleEngine::noteOn (int midiNote, float velocity)
+void SampleEngine::setPadSound (int midiNote, const PadSound& sound)
 {
     if (midiNote < 0 || midiNote >= kTotalSlots)
         return;
 
     auto& slot = slots[(size_t) midiNote];
-    if (! slot.loaded)
+    slot.pan.store (juce::jlimit (-1.0f, 1.0f, sound.pan));
+    slot.tune.store (juce::jlimit (-kMaxTuneSemitones, kMaxTuneSemitones, sound.tune));
+    slot.attackMs.store (juce::jlimit (0.0f, kMaxEnvelopeMs, sound.attackMs));
+    slot.holdMs.store (juce::jlimit (0.0f, kMaxEnvelopeMs, sound.holdMs));
+    slot.decayMs.store (juce::jlimit (0.0f, kMaxEnvelopeMs, sound.decayMs));
+    ++padStateVersion;
+}
+
+SampleEngine::PadSound SampleEngine::getPadSound (int midiNote) const
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return {};
+
+    auto& slot = slots[(size_t) midiNote];
+    return { slot.pan.load(), slot.tune.load(), slot.attackMs.load(), slot.holdMs.load(), slot.decayMs.load() };
+}
+
+void SampleEngine::setPadPan (int midiNote, float pan)
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return;
+    slots[(size_t) midiNote].pan.store (juce::jlimit (-1.0f, 1.0f, pan));
+}
+
+float SampleEngine::getPadPan (int midiNote) const
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return 0.0f;
+    return slots[(size_t) midiNote].pan.load();
+}
+
+void SampleEngine::setPadPolyphony (int midiNote, int numVoices)
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return;
+    slots[(size_t) midiNote].polyphony.store (juce::jlimit (1, kMaxPadPolyphony, numVoices));
+    ++padStateVersion;
+}
+
+int SampleEngine::getPadPolyphony (int midiNote) const
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return kDefaultPadPolyphony;
+    return slots[(size_t) midiNote].polyphony.load();
+}
+
+void SampleEngine::setPadChokeGroup (int midiNote, int group)
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return;
+    slots[(size_t) midiNote].chokeGroup.store (juce::jlimit (0, kNumChokeGroups, group));
+    ++padStateVersion;
+}
+
+int SampleEngine::getPadChokeGroup (int midiNote) const
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return 0;
+    return slots[(size_t) midiNote].chokeGroup.load();
+}
+
+void SampleEngine::setPadOutput (int midiNote, int bus)
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return;
+    slots[(size_t) midiNote].output.store (juce::jlimit (0, kMaxOutputBuses - 1, bus));
+    ++padStateVersion;
+}
+
+int SampleEngine::getPadOutput (int midiNote) const
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return 0;
+    return slots[(size_t) midiNote].output.load();
+}
+
+void SampleEngine::setMaxVoices (int numVoices)
+{
+    maxVoices.store (juce::jlimit (1, kMaxVoiceLimit, numVoices));
+}
+
+void SampleEngine::noteOn (int midiNote, float velocity)
+{
+    if (midiNote < 0 || midiNote >= kTotalSlots)
+        return;
+
+    auto* table = liveTable.load (std::memory_order_acquire);
+    const SampleData::Ptr* sample = &table->samples[(size_t) midiNote];
+    if (*sample == nullptr || (*sample)->missing)
         return;
 
-    for (auto& voice : slot.voices)
+    // Multi-layer pads: O(1) zone lookup, then the zone's next round-robin sample
+    if (auto* layers = table->layers[(size_t) midiNote].get())
     {
-        if (! voice.active.load())
-        {
-            voice.position = 0;
-            voice.velocity = velocity;
-            voice.active.store (true);
+        auto zoneIndex = layers->zoneForVelocity[(size_t) juce::jlimit (1, 127, juce::roundToInt (velocity * 127.0f))];
+        if (zoneIndex < 0)
             return;
+
+        auto& zone = layers->zones[(size_t) zoneIndex];
+        auto& position = roundRobinPositions[(size_t) midiNote][(size_t) zoneIndex];
+        if (position >= zone.count)
+            position = 0;
+
+        sample = &layers->samples[(size_t) (zone.first + position++)];
+    }
+
+    if (auto group = slots[(size_t) midiNote].chokeGroup.load (std::memory_order_relaxed); group > 0)
+        chokeOtherPads (midiNote, group);
+
+    if (voices.voicesPerPad[(size_t) midiNote] >= slots[(size_t) midiNote].polyphony.load (std::memory_order_relaxed))
+        stealVoice (midiNote);
+
+    if ((int) voices.active.size() - voices.numFading >= maxVoices.load (std::memory_order_relaxed))
+        stealVoice (-1);
+
+    // Every pool voice is still fading out: cut the oldest one short
+    if (voices.free.empty())
+    {
+        for (size_t i = 0; i < voices.active.size(); ++i)
+        {
+            if (voices.fades[(size_t) voices.active[i]] > 0)
+            {
+                releaseVoice (i);
+                break;
+            }
         }
     }
 
-    // Steal oldest voice (voice 0)
-    slot.voices[0].position = 0;
-    slot.voices[0].velocity = velocity;
-    slot.voices[0].active.store (true);
+    startVoice (midiNote, *sample, velocity);
 }
 
-void SampleEngine::renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+void SampleEngine::startVoice (int midiNote, const SampleData::Ptr& sample, float velocity)
 {
-    for (auto& slot : slots)
+    if (voices.free.empty())
+        return;
+
+    int v = voices.free.back();
+    voices.free.pop_back();
+    voices.active.push_back (v);
+    ++voices.voicesPerPad[(size_t) midiNote];
+
+    auto index = (size_t) v;
+    voices.samples[index] = sample;
+    auto& slot = slots[(size_t) midiNote];
+    voices.positions[index] = 0.0;
+    voices.rates[index] = tuneToRate (slot.tune.load (std::memory_order_relaxed));
+    voices.ages[index] = 0;
+    voices.velocities[index] = velocity;
+    voices.notes[index] = midiNote;
+    voices.fades[index] = 0;
+    voices.levels[index] = velocity * slot.volume.load (std::memory_order_relaxed);
+    voices.streams[index] = sample->streamed ? diskStreamer.startStream (sample) : -1;
+}
+
+void SampleEngine::releaseVoice (size_t activeIndex)
+{
+    int v = voices.active[activeIndex];
+    auto index = (size_t) v;
+
+    if (voices.streams[index] >= 0)
+        diskStreamer.stopStream (voices.streams[index]);
+
+    voices.streams[index] = -1;
+    voices.samples[index] = nullptr;
+
+    if (voices.fades[index] > 0)
+        --voices.numFading;
+    else
+        --voices.voicesPerPad[(size_t) voices.notes[index]];
+
+    voices.fades[index] = 0;
+
+    voices.active.erase (voices.active.begin() + (std::ptrdiff_t) activeIndex);
+    voices.free.push_back (v);
+}
+
+// Fades out one voice of midiNote, or of any pad when midiNote is -1
+void SampleEngine::stealVoice (int midiNote)
+{
+    auto policy = stealPolicy.load (std::memory_order_relaxed);
+    int victim = -1;
+    float victimScore = 0.0f;
+
+    for (int v : voices.active)
     {
-        if (! slot.loaded)
+        auto index = (size_t) v;
+        if (voices.fades[index] > 0 || (midiNote >= 0 && voices.notes[index] != midiNote))
             continue;
 
-        for (auto& voice : slot.voices)
+        // The active list is oldest first
+        if (policy == StealPolicy::Oldest)
+        {
+            victim = v;
+            break;
+        }
+
+        float score = policy == StealPolicy::Quietest ? voices.levels[index] : voices.velocities[index];
+        if (victim < 0 || score < victimScore)
         {
-            if (! voice.active.load())
-                continue;
+            victim = v;
+            victimScore = score;
+        }
+    }
 
-            int samplesAvailable = slot.buffer.getNumSamples() - voice.position;
-            int samplesToRender = juce::jmin (numSamples, samplesAvailable);
+    if (victim >= 0)
+        fadeOutVoice (victim);
+}
 
-            if (samplesToRender <= 0)
-            {
-                voice.active.store (false);
-                continue;
-            }
+// Fades out the ringing voices of every other pad in the group
+void SampleEngine::chokeOtherPads (int midiNote, int group)
+{
+    for (int v : voices.active)
+    {
+        auto index = (size_t) v;
+        int note = voices.notes[index];
+
+        if (note != midiNote && voices.fades[index] == 0
+            && slots[(size_t) note].chokeGroup.load (std::memory_order_relaxed) == group)
+            fadeOutVoice (v);
+    }
+}
+
+void SampleEngine::fadeOutVoice (int voice)
+{
+    auto index = (size_t) voice;
+    voices.fades[index] = fadeOutFrames;
+    --voices.voicesPerPad[(size_t) voices.notes[index]];
+    ++voices.numFading;
+}
+
+void SampleEngine::releaseAllVoices()
+{
+    while (! voices.active.empty())
+        releaseVoice (voices.active.size() - 1);
+}
+
+void SampleEngine::queueNoteOn (int midiNote, float velocity)
+{
+    const auto scope = pendingFifo.write (1);
+
+    if (scope.blockSize1 > 0)
+        pendingTriggers[(size_t) scope.startIndex1] = { midiNote, velocity };
+    else if (scope.blockSize2 > 0)
+        pendingTriggers[(size_t) scope.startIndex2] = { midiNote, velocity };
+}
+
+void SampleEngine::drainPendingTriggers()
+{
+    const auto scope = pendingFifo.read (pendingFifo.getNumReady());
+
+    scope.forEach ([this] (int index)
+    {
+        auto& trigger = pendingTriggers[(size_t) index];
+        if (trigger.velocity > 0.0f)
+            noteOn (trigger.midiNote, trigger.velocity);
+        else
+            for (int v : voices.active)
+                if (voices.notes[(size_t) v] == trigger.midiNote && voices.fades[(size_t) v] == 0)
+                    fadeOutVoice (v);
+    });
+}
+
+void SampleEngine::renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    drainPendingTriggers();
+
+    for (size_t i = 0; i < voices.active.size();)
+    {
+        if (renderVoice (voices.active[i], outputBuffer, startSample, numSamples))
+            ++i;
+        else
+            releaseVoice (i);
+    }
+
+    renderedBlocks.fetch_add (1, std::memory_order_release);
+}
+
+float SampleEngine::EnvelopeShape::gainAt (int age) const
+{
+    if (age < attack)
+        return (float) age / (float) attack;
+
+    age -= attack + hold;
+    if (decay == 0 || age < 0)
+        return 1.0f;
+
+    return juce::jmax (0.0f, 1.0f - (float) age / (float) decay);
+}
+
+int SampleEngine::EnvelopeShape::nextCorner (int age) const
+{
+    for (int corner : { attack, attack + hold, end() })
+        if (corner > age)
+            return corner;
+
+    return std::numeric_limits<int>::max();
+}
+
+// A streamed voice that found no free stream plays its head only
+juce::int64 SampleEngine::getVoiceLength (int voice) const
+{
+    auto index = (size_t) voice;
+    auto& sample = *voices.samples[index];
+
+    if (voices.streams[index] >= 0 || sample.mappedReader != nullptr)
+        return sample.lengthInFrames;
+
+    return sample.buffer.getNumSamples();
+}
+
+// Copies a voice's source frames [firstFrame, firstFrame + numFrames) into
+// dest, from the head in memory and then the stream or mapping. Frames
+// outside the sample are silent.
+void SampleEngine::readSourceFrames (int voice, juce::int64 firstFrame, int numFrames, juce::AudioBuffer<float>& dest)
+{
+    auto index = (size_t) voice;
+    auto& sample = *voices.samples[index];
+    auto& head = sample.buffer;
+    int channels = juce::jmin (sample.getNumChannels(), dest.getNumChannels());
+    auto lastFrame = firstFrame + numFrames;
+
+    for (int ch = 0; ch < channels; ++ch)
+        dest.clear (ch, 0, numFrames);
+
+    auto from = juce::jmax ((juce::int64) 0, firstFrame);
+    auto headEnd = juce::jmin (lastFrame, (juce::int64) head.getNumSamples());
+
+    if (from < headEnd)
+        for (int ch = 0; ch < channels; ++ch)
+            dest.copyFrom (ch, (int) (from - firstFrame), head, ch, (int) from, (int) (headEnd - from));
+
+    auto tailStart = juce::jmax (from, (juce::int64) head.getNumSamples());
+    auto tailEnd = juce::jmin (lastFrame, getVoiceLength (voice));
 
-            float gain = voice.velocity * slot.volume;
-            int outChannels = outputBuffer.getNumChannels();
-            int srcChannels = slot.buffer.getNumChannels();
+    if (tailStart >= tailEnd)
+        return;
+
+    float* tail[DiskStreamer::kMaxChannels] = {};
+    for (int ch = 0; ch < channels; ++ch)
+        tail[ch] = dest.getWritePointer (ch, (int) (tailStart - firstFrame));
+
+    if (auto* mapped = sample.mappedReader.get())
+        mapped->read (tail, channels, tailStart, (int) (tailEnd - tailStart));
+    else
+        diskStreamer.readFrames (voices.streams[index], tailStart, (int) (tailEnd - tailStart), tail, channels);
+}
+
+// Returns false once the voice has played to the end
+bool SampleEngine::renderVoice (int voice, juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    auto index = (size_t) voice;
+    auto& sample = *voices.samples[index];
+    auto& head = sample.buffer;
+    int headFrames = head.getNumSamples();
+    auto* mapped = sample.mappedReader.get();
+    int stream = voices.streams[index];
+    double position = voices.positions[index];
+    int fade = voices.fades[index];
+    int age = voices.ages[index];
+    auto length = getVoiceLength (voice);
+
+    // The pad's parameters are read once; gain and speed ramp towards them
+    // across this render
+    auto& slot = slots[(size_t) voices.notes[index]];
+    float gain = voices.velocities[index] * slot.volume.load (std::memory_order_relaxed);
+    float pan = slot.pan.load (std::memory_order_relaxed);
+    float startRate = voices.rates[index];
+    float targetRate = tuneToRate (slot.tune.load (std::memory_order_relaxed));
+
+    double framesPerMs = currentSampleRate.load (std::memory_order_relaxed) * 0.001;
+    EnvelopeShape envelope { (int) (slot.attackMs.load (std::memory_order_relaxed) * framesPerMs),
+                             (int) (slot.holdMs.load (std::memory_order_relaxed) * framesPerMs),
+                             (int) (slot.decayMs.load (std::memory_order_relaxed) * framesPerMs) };
+
+    bool varispeed = startRate != 1.0f || targetRate != 1.0f || position != std::floor (position);
+
+    int samplesToRender = numSamples;
+    if (! varispeed)
+        samplesToRender = (int) juce::jmin ((juce::int64) samplesToRender, length - (juce::int64) position);
+    if (fade > 0)
+        samplesToRender = juce::jmin (samplesToRender, fade);
+    if (envelope.decay > 0)
+        samplesToRender = juce::jmin (samplesToRender, envelope.end() - age);
+
+    if (samplesToRender <= 0 || position >= (double) length)
+        return false;
+
+    // Render straight into the channels of the pad's bus
+    auto bus = outputLayout[(size_t) slot.output.load (std::memory_order_relaxed)];
+    if (bus.numChannels == 0)
+        bus = outputLayout[0];
+    if (bus.numChannels == 0 || bus.firstChannel + bus.numChannels > outputBuffer.getNumChannels())
+        bus = { 0, outputBuffer.getNumChannels() };
+
+    int outChannels = juce::jmin (2, bus.numChannels);
+    int srcChannels = sample.getNumChannels();
+    bool trackLevel = stealPolicy.load (std::memory_order_relaxed) == StealPolicy::Quietest;
+    float peak = 0.0f;
+    int rendered = 0;
+
+    // Gains ramp from where the last render left off to the current volume
+    // and pan, and on to silence while the voice is fading out after a steal.
+    // A new voice starts at its target. Pan needs a stereo bus; a mono bus
+    // takes the pad at full level.
+    auto target = outChannels > 1 ? VoiceMixer::panGains (gain, pan, srcChannels > 1)
+                                  : VoiceMixer::StereoGain { gain, gain };
+    auto blockStart = age == 0 ? target : voices.gains[index];
+    auto blockEnd = target;
+
+    if (fade > 0)
+    {
+        blockStart = VoiceMixer::scale (blockStart, (float) fade / (float) fadeOutFrames);
+        blockEnd = VoiceMixer::scale (blockEnd, (float) (fade - samplesToRender) / (float) fadeOutFrames);
+    }
+
+    float* destinations[2] = { outputBuffer.getWritePointer (bus.firstChannel, startSample),
+                               outputBuffer.getWritePointer (bus.firstChannel + outChannels - 1, startSample) };
+
+    // Mixes frames [offset, offset + count) of this render, split at the
+    // envelope's corners so every piece is a straight gain ramp
+    auto mix = [&] (const juce::AudioBuffer<float>& src, int srcStart, int offset, int count)
+    {
+        for (int done = 0; done < count;)
+        {
+            int frame = offset + done;
+            int piece = juce::jmin (count - done, envelope.nextCorner (age + frame) - (age + frame));
 
-            for (int ch = 0; ch < outChannels; ++ch)
+            const float* sources[2] = { src.getReadPointer (0, srcStart + done),
+                                        src.getReadPointer (juce::jmin (2, srcChannels) - 1, srcStart + done) };
+            float* dst[2] = { destinations[0] + frame, destinations[1] + frame };
+
+            auto from = VoiceMixer::lerp (blockStart, blockEnd, (float) frame / (float) samplesToRender);
+            auto to = VoiceMixer::lerp (blockStart, blockEnd, (float) (frame + piece) / (float) samplesToRender);
+
+            VoiceMixer::mix (sources, srcChannels, dst, outChannels, piece,
+                             VoiceMixer::scale (from, envelope.gainAt (age + frame)),
+                             VoiceMixer::scale (to, envelope.gainAt (age + frame + piece)));
+            done += piece;
+        }
+
+        if (trackLevel)
+            peak = juce::jmax (peak, src.getMagnitude (0, srcStart, count));
+    };
+
+    if (! varispeed)
+    {
+        auto start = (int) position;
+
+        if (start < headFrames)
+        {
+            rendered = juce::jmin (samplesToRender, headFrames - start);
+            mix (head, start, 0, rendered);
+        }
+
+        while (rendered < samplesToRender)
+        {
+            int chunk = juce::jmin (samplesToRender - rendered, streamScratch.getNumSamples());
+
+            if (mapped != nullptr)
+                mapped->read (streamScratch.getArrayOfWritePointers(), srcChannels, start + rendered, chunk);
+            else
+                diskStreamer.readFrames (stream, start + rendered, chunk,
+                                         streamScratch.getArrayOfWritePointers(), srcChannels);
+
+            mix (streamScratch, 0, rendered, chunk);
+            rendered += chunk;
+        }
+
+        position += samplesToRender;
+    }
+    else
+    {
+        // Varispeed: interpolate each chunk from the source frames it spans,
+        // sizing chunks so those fit the scratch buffer at the fastest rate
+        float maxRate = juce::jmax (startRate, targetRate);
+        int maxChunk = juce::jmax (1, (int) ((float) (streamScratch.getNumSamples() - 4) / maxRate));
+        int channels = juce::jmin (srcChannels, DiskStreamer::kMaxChannels);
+        bool finished = false;
+
+        while (rendered < samplesToRender && ! finished)
+        {
+            int chunk = juce::jmin (samplesToRender - rendered, maxChunk, varispeedScratch.getNumSamples());
+            auto firstFrame = (juce::int64) position - 1;
+            int span = juce::jmin (streamScratch.getNumSamples(), (int) std::ceil ((float) chunk * maxRate) + 4);
+            readSourceFrames (voice, firstFrame, span, streamScratch);
+
+            auto* const* src = streamScratch.getArrayOfReadPointers();
+            auto* const* out = varispeedScratch.getArrayOfWritePointers();
+            int produced = 0;
+            for (; produced < chunk; ++produced)
             {
-                int srcCh = juce::jmin (ch, srcChannels - 1);
-                outputBuffer.addFrom (ch, startSample, slot.buffer,
-                                      srcCh, voice.position, samplesToRender, gain);
+                if (position >= (double) length)
+                {
+                    finished = true;
+                    break;
+                }
+
+                auto local = position - (double) firstFrame;
+                auto i = (int) local;
+                auto t = (float) (local - i);
+
+                for (int ch = 0; ch < channels; ++ch)
+                    out[ch][produced] = hermite (src[ch][i - 1], src[ch][i], src[ch][i + 1], src[ch][i + 2], t);
+
+                float ramp = (float) (rendered + produced) / (float) samplesToRender;
+                position += (double) (startRate + (targetRate - startRate) * ramp);
             }
 
-            voice.position += samplesToRender;
-            if (voice.position >= slot.buffer.getNumSamples())
-                voice.active.store (false);
+            mix (varispeedScratch, 0, rendered, produced);
+            rendered += produced;
         }
+
+        samplesToRender = rendered;
     }
+
+    if (trackLevel)
+        voices.levels[index] = peak * gain;
+
+    voices.gains[index] = target;
+    voices.rates[index] = targetRate;
+    voices.positions[index] = position;
+    voices.ages[index] = age + samplesToRender;
+
+    if (fade > 0)
+    {
+        voices.fades[index] = fade - samplesToRender;
+        if (voices.fades[index] <= 0)
+            return false;
+    }
+
+    if (envelope.decay > 0 && voices.ages[index] >= envelope.end())
+        return false;
+
+    return position < (double) length;
 }
 
 void SampleEngine::clearAllSamples()
 {
-    for (int i = 0; i < kTotalSlots; ++i)
-        clearSample (i);
+    publishKit ({});
 }
 
 void SampleEngine::markSampleMissing (int midiNote, const juce::String& name)
@@ -222,34 +974,84 @@ void SampleEngine::markSampleMissing (int midiNote, const juce::String& name)
     if (midiNote < 0 || midiNote >= kTotalSlots)
         return;
 
-    std::lock_guard<std::mutex> lock (loadMutex);
-    auto& slot = slots[(size_t) midiNote];
-    for (auto& voice : slot.voices)
-        voice.active.store (false);
-    slot.buffer.setSize (0, 0);
-    slot.sampleName = name;
-    slot.sampleFile = juce::File();
-    slot.loaded = false;
-    slot.missing = true;
+    publishSample (midiNote, createMissingSample (name));
+}
+
+SampleEngine::SampleData::Ptr SampleEngine::createMissingSample (const juce::String& name)
+{
+    SampleData::Ptr data = new SampleData();
+    data->name = name;
+    data->missing = true;
+
+    std::lock_guard<std::mutex> lock (tableMutex);
+    samplePool.add (data);
+    return data;
 }
 
 bool SampleEngine::isSampleMissing (int midiNote) const
 {
-    if (midiNote < 0 || midiNote >= kTotalSlots)
-        return false;
-    return slots[(size_t) midiNote].missing;
+    auto sample = getSample (midiNote);
+    return sample != nullptr && sample->missing;
 }
 
 void SampleEngine::previewSample (const juce::File& file)
 {
     stopPreview();
     loadSample (kPreviewSlot, file);
-    noteOn (kPreviewSlot, 0.8f);
+    queueNoteOn (kPreviewSlot, 0.8f);
 }
 
 void SampleEngine::stopPreview()
 {
-    auto& slot = slots[(size_t) kPreviewSlot];
-    for (auto& voice : slot.voices)
-        voice.active.store (false);
+    queueNoteOn (kPreviewSlot, 0.0f);
+}
+
+void SampleEngine::reclaimRetired()
+{
+    std::vector<std::unique_ptr<SlotTable>> tablesToFree;
+    juce::ReferenceCountedArray<SampleData> samplesToFree;
+
+    {
+        std::lock_guard<std::mutex> lock (tableMutex);
+        auto completedBlocks = renderedBlocks.load (std::memory_order_acquire);
+        bool idle = ! audioRunning.load();
+
+        for (auto it = retiredTables.begin(); it != retiredTables.end();)
+        {
+            if (idle || (*it)->retiredAtBlock < completedBlocks)
+            {
+                tablesToFree.push_back (std::move (*it));
+                it = retiredTables.erase (it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    tablesToFree.clear();
+
+    {
+        // A count of one means only the pool still references the sample:
+        // no table, voice or loader can reach it any more.
+        std::lock_guard<std::mutex> lock (tableMutex);
+        for (int i = samplePool.size(); --i >= 0;)
+        {
+            if (samplePool.getObjectPointerUnchecked (i)->getReferenceCount() == 1)
+            {
+                samplesToFree.add (samplePool.getObjectPointerUnchecked (i));
+                samplePool.remove (i);
+            }
+        }
+    }
+}
+
+void SampleEngine::ReclaimThread::run()
+{
+    while (! threadShouldExit())
+    {
+        engine.reclaimRetired();
+        wait (250);
+    }
 }
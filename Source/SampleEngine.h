@@ -1,14 +1,38 @@
 #pragma once
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
+#include "SampleCache.h"
+#include "SampleData.h"
+#include "DiskStreamer.h"
+#include "VoiceMixer.h"
 #include <array>
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 class SampleEngine
 {
 public:
     SampleEngine();
+    ~SampleEngine();
+
+    using SampleData = ::SampleData;
+
+    // One velocity zone of a multi-layer pad; its samples play round-robin
+    struct SampleLayer
+    {
+        int velocityLow = 1;
+        int velocityHigh = 127;
+        std::vector<SampleData::Ptr> roundRobin;
+    };
+
+    struct PadSample
+    {
+        int midiNote = -1;
+        SampleData::Ptr sample;
+        std::vector<SampleLayer> layers;   // empty for single-sample pads
+    };
 
     void prepareToPlay (double sampleRate, int samplesPerBlock);
     void releaseResources();
@@ -20,46 +44,266 @@ public:
     juce::String getSampleName (int midiNote) const;
     juce::File getSampleFile (int midiNote) const;
 
+    // Audio thread only. The processor renders each host block in pieces,
+    // split at trigger positions.
     void noteOn (int midiNote, float velocity);
     void renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples);
 
+    // Where each output bus's channels sit in the buffer given to
+    // renderNextBlock, set by the processor before rendering. Pads routed
+    // to a bus without channels play through bus 0.
+    static constexpr int kMaxOutputBuses = 16;
+
+    struct OutputBus
+    {
+        int firstChannel = 0;
+        int numChannels = 0;
+    };
+
+    using OutputLayout = std::array<OutputBus, kMaxOutputBuses>;
+    void setOutputLayout (const OutputLayout& layout) { outputLayout = layout; }
+
+    // Message thread triggers (pad clicks, previews), applied on the next render
+    void queueNoteOn (int midiNote, float velocity);
+
     void clearAllSamples();
 
+    // Thread-safe: used by the background kit loader
+    SampleData::Ptr decodeSample (const juce::File& file);
+    SampleData::Ptr createMissingSample (const juce::String& name);
+    void publishSample (int midiNote, const SampleData::Ptr& sample);
+    void publishPad (const PadSample& pad);
+    void publishKit (const std::vector<PadSample>& pads);
+
+    std::vector<SampleLayer> getPadLayers (int midiNote) const;
+
+    static constexpr int kMaxVelocityZones = 16;
+
+    SampleCache& getSampleCache() { return sampleCache; }
+
+    // Samples longer than twice the preload keep only their first preloadMs
+    // in memory and stream the rest from disk. 0 disables streaming.
+    void setStreamingPreloadMs (int preloadMs);
+    int getStreamingPreloadMs() const { return streamingPreloadMs.load(); }
+    juce::uint32 getNumStreamUnderruns() const { return diskStreamer.getNumUnderruns(); }
+
+    // Uncompressed WAV/AIFF files at the engine rate are memory-mapped
+    // instead of decoded, so instances share them through the page cache.
+    void setMemoryMappingEnabled (bool shouldMap);
+    bool isMemoryMappingEnabled() const { return memoryMapping.load(); }
+
+    void setResampleQuality (Resampler::Quality quality);
+    Resampler::Quality getResampleQuality() const { return resampleQuality.load(); }
+
     void setPadVolume (int midiNote, float volume);
     float getPadVolume (int midiNote) const;
 
+    // Pan (-1..1), tuning in semitones (played back varispeed) and an
+    // attack-hold-decay envelope. A decay of 0 lets the sample ring out.
+    struct PadSound
+    {
+        float pan = 0.0f;
+        float tune = 0.0f;
+        float attackMs = 0.0f;
+        float holdMs = 0.0f;
+        float decayMs = 0.0f;
+
+        bool operator== (const PadSound&) const = default;
+    };
+
+    void setPadSound (int midiNote, const PadSound& sound);
+    PadSound getPadSound (int midiNote) const;
+    void setPadPan (int midiNote, float pan);
+    float getPadPan (int midiNote) const;
+
+    static constexpr float kMaxTuneSemitones = 24.0f;
+    static constexpr float kMaxEnvelopeMs = 10000.0f;
+
+    // Voices a pad may ring at once, and the cap across all pads. A pad or
+    // the engine at its limit fades out a voice chosen by the steal policy.
+    enum class StealPolicy { Oldest, Quietest, LowestVelocity };
+
+    void setPadPolyphony (int midiNote, int numVoices);
+    int getPadPolyphony (int midiNote) const;
+    void setMaxVoices (int numVoices);
+    int getMaxVoices() const { return maxVoices.load(); }
+    void setStealPolicy (StealPolicy policy) { stealPolicy.store (policy); }
+    StealPolicy getStealPolicy() const { return stealPolicy.load(); }
+
+    // Triggering a pad fades out the voices of the other pads in its choke
+    // group (open hi-hat cut by closed or pedal). 0 = no group.
+    void setPadChokeGroup (int midiNote, int group);
+    int getPadChokeGroup (int midiNote) const;
+
+    // Output bus (0 = main) the pad renders into
+    void setPadOutput (int midiNote, int bus);
+    int getPadOutput (int midiNote) const;
+
+    static constexpr int kNumChokeGroups = 8;
+    static constexpr int kDefaultPadPolyphony = 8;
+    static constexpr int kMaxPadPolyphony = 16;
+    static constexpr int kDefaultMaxVoices = 128;
+    static constexpr int kMaxVoiceLimit = 256;
+
     void markSampleMissing (int midiNote, const juce::String& name);
     bool isSampleMissing (int midiNote) const;
 
+    // Changes whenever the samples, layers or settings of any pad change,
+    // apart from volume and pan, which the processor keeps as parameters
+    juce::uint32 getPadStateVersion() const { return padStateVersion.load(); }
+
     void previewSample (const juce::File& file);
     void stopPreview();
 
     static constexpr int kPreviewSlot = 0;
 
 private:
-    static constexpr int kMaxVoicesPerPad = 8;
     static constexpr int kTotalSlots = 128;
+    static constexpr int kPendingTriggerCapacity = 256;
+
+    static constexpr int kVoicePoolSize = kMaxVoiceLimit + 64;   // headroom for stolen voices fading out
+
+    // Written by the message thread, read by the audio thread once per
+    // render. Each pad gets its own cache line so edits to one pad never
+    // contend with reads of its neighbours.
+    struct alignas (64) SampleSlot
+    {
+        std::atomic<float> volume { 1.0f };
+        std::atomic<float> pan { 0.0f };
+        std::atomic<float> tune { 0.0f };
+        std::atomic<float> attackMs { 0.0f };
+        std::atomic<float> holdMs { 0.0f };
+        std::atomic<float> decayMs { 0.0f };
+        std::atomic<int> polyphony { kDefaultPadPolyphony };
+        std::atomic<int> chokeGroup { 0 };
+        std::atomic<int> output { 0 };
+
+        void reset();
+        void swapWith (SampleSlot& other);
+    };
+
+    // Envelope corners in frames since the voice started
+    struct EnvelopeShape
+    {
+        int attack = 0, hold = 0, decay = 0;
+
+        int end() const { return attack + hold + decay; }
+        float gainAt (int age) const;
+        int nextCorner (int age) const;
+    };
+
+    // Structure-of-arrays voice storage, sized in prepareToPlay. Only the
+    // voices listed in active (oldest first) are touched when rendering.
+    struct VoicePool
+    {
+        std::vector<SampleData::Ptr> samples;
+        std::vector<double> positions;
+        std::vector<float> rates;    // playback speed reached at the end of the last render
+        std::vector<int> ages;       // frames rendered, for the envelope
+        std::vector<float> velocities;
+        std::vector<int> streams;
+        std::vector<int> notes;
+        std::vector<int> fades;      // frames of fade-out left, 0 while not stolen
+        std::vector<float> levels;   // last block's peak, for the Quietest policy
+        std::vector<VoiceMixer::StereoGain> gains;   // reached at the end of the last render
+
+        std::vector<int> active;
+        std::vector<int> free;
+        std::array<int, kTotalSlots> voicesPerPad {};   // voices not fading out
+        int numFading = 0;
+    };
+
+    // Velocity -> zone lookup for a multi-layer pad. Each zone is a run of
+    // round-robin samples in the pad's contiguous sample array.
+    struct PadLayers
+    {
+        struct Zone
+        {
+            int velocityLow = 1, velocityHigh = 127;
+            int first = 0, count = 0;
+        };
+
+        std::array<juce::int8, 128> zoneForVelocity;   // -1 plays nothing
+        std::vector<Zone> zones;
+        std::vector<SampleData::Ptr> samples;
+    };
+
+    // Note -> sample mapping, published to the audio thread as a whole by
+    // a single pointer swap. Retired tables are kept until the audio thread
+    // has finished the block in which it might still have been reading them.
+    struct SlotTable
+    {
+        std::array<SampleData::Ptr, kTotalSlots> samples;
+        std::array<std::shared_ptr<const PadLayers>, kTotalSlots> layers;
+        juce::uint64 retiredAtBlock = 0;
+    };
 
-    struct Voice
+    struct PendingTrigger
     {
-        std::atomic<bool> active { false };
-        int position = 0;
-        float velocity = 1.0f;
+        int midiNote = 0;
+        float velocity = 0.0f;   // 0 stops the pad
     };
 
-    struct SampleSlot
+    class ReclaimThread : public juce::Thread
     {
-        juce::AudioBuffer<float> buffer;
-        juce::String sampleName;
-        juce::File sampleFile;
-        bool loaded = false;
-        bool missing = false;
-        float volume = 1.0f;
-        std::array<Voice, kMaxVoicesPerPad> voices;
+    public:
+        explicit ReclaimThread (SampleEngine& e) : juce::Thread ("Beatwerk Sample Reclaim"), engine (e) {}
+        void run() override;
+
+    private:
+        SampleEngine& engine;
     };
 
     std::array<SampleSlot, kTotalSlots> slots;
+    VoicePool voices;
+    OutputLayout outputLayout {};   // audio thread only
+    std::array<std::array<juce::uint8, kMaxVelocityZones>, kTotalSlots> roundRobinPositions {};   // audio thread only
+    int fadeOutFrames = 256;
+
+    std::atomic<int> maxVoices { kDefaultMaxVoices };
+    std::atomic<StealPolicy> stealPolicy { StealPolicy::Oldest };
+
+    std::atomic<SlotTable*> liveTable { nullptr };
+    std::unique_ptr<SlotTable> ownedLiveTable;
+    std::vector<std::unique_ptr<SlotTable>> retiredTables;
+    juce::ReferenceCountedArray<SampleData> samplePool;
+    mutable std::mutex tableMutex;
+
+    std::atomic<juce::uint64> renderedBlocks { 0 };
+    std::atomic<juce::uint32> padStateVersion { 0 };
+    std::atomic<bool> audioRunning { false };
+
+    juce::AbstractFifo pendingFifo { kPendingTriggerCapacity };
+    std::array<PendingTrigger, kPendingTriggerCapacity> pendingTriggers;
+
     juce::AudioFormatManager formatManager;
-    double currentSampleRate = 44100.0;
-    std::mutex loadMutex;
+    SampleCache sampleCache;
+    std::atomic<double> currentSampleRate { 44100.0 };
+    std::atomic<int> streamingPreloadMs { 0 };
+    std::atomic<bool> memoryMapping { true };
+    std::atomic<Resampler::Quality> resampleQuality { Resampler::Quality::Medium };
+    juce::ThreadPool conversionPool { juce::jlimit (1, 4, juce::SystemStats::getNumCpus() - 1) };
+
+    DiskStreamer diskStreamer { formatManager };
+    juce::AudioBuffer<float> streamScratch { DiskStreamer::kMaxChannels, 512 };
+    juce::AudioBuffer<float> varispeedScratch { DiskStreamer::kMaxChannels, 512 };
+
+    ReclaimThread reclaimThread { *this };
+
+    SampleData::Ptr getSample (int midiNote) const;
+    static std::shared_ptr<const PadLayers> makePadLayers (const std::vector<SampleLayer>& layers);
+    SampleData::Ptr mapSample (const juce::File& file, double targetRate);
+    SampleData::Ptr addToPool (const juce::File& file, double targetRate, SampleData::Ptr data);
+    template <typename Modifier> void updateTable (Modifier&& modify);
+    void drainPendingTriggers();
+    void startVoice (int midiNote, const SampleData::Ptr& sample, float velocity);
+    void releaseVoice (size_t activeIndex);
+    void stealVoice (int midiNote);
+    void chokeOtherPads (int midiNote, int group);
+    void fadeOutVoice (int voice);
+    void releaseAllVoices();
+    bool renderVoice (int voice, juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples);
+    juce::int64 getVoiceLength (int voice) const;
+    void readSourceFrames (int voice, juce::int64 firstFrame, int numFrames, juce::AudioBuffer<float>& dest);
+    void reclaimRetired();
 };
@@ -0,0 +1,86 @@
+#include "StateFormat.h"
+
+namespace
+{
+    constexpr size_t kHeaderSize = 4 * sizeof (juce::uint32);
+
+    // FNV-1a
+    juce::uint32 checksum (const void* data, size_t size)
+    {
+        juce::uint32 hash = 2166136261u;
+        auto* bytes = static_cast<const juce::uint8*> (data);
+
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ bytes[i]) * 16777619u;
+
+        return hash;
+    }
+}
+
+int StateFormat::PathTable::intern (const juce::File& file)
+{
+    auto path = file.isAChildOf (base) ? file.getRelativePathFrom (base) : file.getFullPathName();
+
+    auto [it, inserted] = indices.try_emplace (path, paths.size());
+    if (inserted)
+        paths.add (path);
+
+    return it->second;
+}
+
+juce::File StateFormat::PathTable::resolve (int index) const
+{
+    if (! juce::isPositiveAndBelow (index, paths.size()))
+        return {};
+
+    auto& path = paths.getReference (index);
+    return juce::File::isAbsolutePath (path) ? juce::File (path) : base.getChildFile (path);
+}
+
+void StateFormat::write (const juce::ValueTree& state, const PathTable& paths, juce::MemoryBlock& dest)
+{
+    juce::MemoryOutputStream payload;
+    payload.writeCompressedInt (paths.paths.size());
+    for (auto& path : paths.paths)
+        payload.writeString (path);
+    state.writeToStream (payload);
+
+    juce::MemoryOutputStream out (dest, false);
+    out.writeInt ((int) kMagic);
+    out.writeInt ((int) kVersion);
+    out.writeInt ((int) payload.getDataSize());
+    out.writeInt ((int) checksum (payload.getData(), payload.getDataSize()));
+    out.write (payload.getData(), payload.getDataSize());
+}
+
+bool StateFormat::isStateData (const void* data, size_t size)
+{
+    return size >= kHeaderSize && juce::ByteOrder::littleEndianInt (data) == kMagic;
+}
+
+juce::ValueTree StateFormat::read (const void* data, size_t size, PathTable& paths)
+{
+    if (! isStateData (data, size))
+        return {};
+
+    juce::MemoryInputStream in (data, size, false);
+    in.readInt();
+    auto version = (juce::uint32) in.readInt();
+    auto payloadSize = (size_t) (juce::uint32) in.readInt();
+    auto expectedChecksum = (juce::uint32) in.readInt();
+
+    auto* payloadData = static_cast<const char*> (data) + kHeaderSize;
+    if (version > kVersion || payloadSize != size - kHeaderSize
+        || checksum (payloadData, payloadSize) != expectedChecksum)
+        return {};
+
+    juce::MemoryInputStream payload (payloadData, payloadSize, false);
+
+    paths.paths.clear();
+    paths.indices.clear();
+
+    for (int i = payload.readCompressedInt(); --i >= 0 && ! payload.isExhausted();)
+        paths.paths.add (payload.readString());
+
+    return juce::ValueTree::readFromStream (payload);
+}
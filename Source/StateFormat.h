@@ -0,0 +1,41 @@
+#pragma once
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+#include <unordered_map>
+
+// Binary container for the plugin state: a versioned header with a
+// checksum, a table of sample paths and the state tree. Pads refer to
+// their files by index into the table, so each path is stored once, and
+// paths inside the samples directory are stored relative to it.
+class StateFormat
+{
+public:
+    class PathTable
+    {
+    public:
+        explicit PathTable (const juce::File& baseDirectory) : base (baseDirectory) {}
+
+        // Returns the file's index, adding it on first use. String work only.
+        int intern (const juce::File& file);
+        juce::File resolve (int index) const;
+
+        void setBaseDirectory (const juce::File& baseDirectory) { base = baseDirectory; }
+
+    private:
+        friend class StateFormat;
+
+        juce::File base;
+        juce::StringArray paths;
+        std::unordered_map<juce::String, int> indices;
+    };
+
+    static void write (const juce::ValueTree& state, const PathTable& paths, juce::MemoryBlock& dest);
+
+    // Returns an invalid tree unless data holds an intact state of a
+    // version this build understands
+    static juce::ValueTree read (const void* data, size_t size, PathTable& paths);
+    static bool isStateData (const void* data, size_t size);
+
+    static constexpr juce::uint32 kMagic = 0x54534b42;   // "BKST"
+    static constexpr juce::uint32 kVersion = 1;
+};
@@ -0,0 +1,152 @@
+#include "VoiceMixer.h"
+#include <cmath>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #define BEATWERK_SSE 1
+ #if defined (__AVX__)
+  #define BEATWERK_AVX 1
+ #endif
+#elif JUCE_ARM && (defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64))
+ #include <arm_neon.h>
+ #define BEATWERK_NEON 1
+#endif
+
+namespace
+{
+    // Frame i gets gainL + i * stepL on the left and gainR + i * stepR on
+    // the right. Vector sections restart their ramps from the frame index,
+    // so rounding doesn't build up across them.
+    template <bool stereoSource, bool stereoOutput>
+    void mixRamped (const float* srcL, const float* srcR, float* dstL, float* dstR, int n,
+                    float gainL, float stepL, float gainR, float stepR) noexcept
+    {
+        int i = 0;
+
+       #if BEATWERK_AVX
+        {
+            auto offsets = _mm256_setr_ps (0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+            auto gL = _mm256_add_ps (_mm256_set1_ps (gainL), _mm256_mul_ps (offsets, _mm256_set1_ps (stepL)));
+            auto gR = _mm256_add_ps (_mm256_set1_ps (gainR), _mm256_mul_ps (offsets, _mm256_set1_ps (stepR)));
+            auto incL = _mm256_set1_ps (stepL * 8.0f);
+            auto incR = _mm256_set1_ps (stepR * 8.0f);
+
+            for (; i + 8 <= n; i += 8)
+            {
+                auto a = _mm256_loadu_ps (srcL + i);
+                _mm256_storeu_ps (dstL + i, _mm256_add_ps (_mm256_loadu_ps (dstL + i), _mm256_mul_ps (a, gL)));
+
+                if constexpr (stereoOutput)
+                {
+                    auto b = stereoSource ? _mm256_loadu_ps (srcR + i) : a;
+                    _mm256_storeu_ps (dstR + i, _mm256_add_ps (_mm256_loadu_ps (dstR + i), _mm256_mul_ps (b, gR)));
+                }
+
+                gL = _mm256_add_ps (gL, incL);
+                gR = _mm256_add_ps (gR, incR);
+            }
+        }
+       #endif
+
+       #if BEATWERK_SSE
+        {
+            auto offsets = _mm_setr_ps ((float) i, (float) i + 1.0f, (float) i + 2.0f, (float) i + 3.0f);
+            auto gL = _mm_add_ps (_mm_set1_ps (gainL), _mm_mul_ps (offsets, _mm_set1_ps (stepL)));
+            auto gR = _mm_add_ps (_mm_set1_ps (gainR), _mm_mul_ps (offsets, _mm_set1_ps (stepR)));
+            auto incL = _mm_set1_ps (stepL * 4.0f);
+            auto incR = _mm_set1_ps (stepR * 4.0f);
+
+            for (; i + 4 <= n; i += 4)
+            {
+                auto a = _mm_loadu_ps (srcL + i);
+                _mm_storeu_ps (dstL + i, _mm_add_ps (_mm_loadu_ps (dstL + i), _mm_mul_ps (a, gL)));
+
+                if constexpr (stereoOutput)
+                {
+                    auto b = stereoSource ? _mm_loadu_ps (srcR + i) : a;
+                    _mm_storeu_ps (dstR + i, _mm_add_ps (_mm_loadu_ps (dstR + i), _mm_mul_ps (b, gR)));
+                }
+
+                gL = _mm_add_ps (gL, incL);
+                gR = _mm_add_ps (gR, incR);
+            }
+        }
+       #elif BEATWERK_NEON
+        {
+            const float start[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+            auto offsets = vld1q_f32 (start);
+            auto gL = vmlaq_n_f32 (vdupq_n_f32 (gainL), offsets, stepL);
+            auto gR = vmlaq_n_f32 (vdupq_n_f32 (gainR), offsets, stepR);
+            auto incL = vdupq_n_f32 (stepL * 4.0f);
+            auto incR = vdupq_n_f32 (stepR * 4.0f);
+
+            for (; i + 4 <= n; i += 4)
+            {
+                auto a = vld1q_f32 (srcL + i);
+                vst1q_f32 (dstL + i, vmlaq_f32 (vld1q_f32 (dstL + i), a, gL));
+
+                if constexpr (stereoOutput)
+                {
+                    auto b = stereoSource ? vld1q_f32 (srcR + i) : a;
+                    vst1q_f32 (dstR + i, vmlaq_f32 (vld1q_f32 (dstR + i), b, gR));
+                }
+
+                gL = vaddq_f32 (gL, incL);
+                gR = vaddq_f32 (gR, incR);
+            }
+        }
+       #endif
+
+        for (; i < n; ++i)
+        {
+            dstL[i] += srcL[i] * (gainL + stepL * (float) i);
+
+            if constexpr (stereoOutput)
+                dstR[i] += (stereoSource ? srcR[i] : srcL[i]) * (gainR + stepR * (float) i);
+        }
+    }
+}
+
+namespace VoiceMixer
+{
+    StereoGain panGains (float gain, float pan, bool stereoSource) noexcept
+    {
+        pan = juce::jlimit (-1.0f, 1.0f, pan);
+
+        if (stereoSource)
+            return { gain * juce::jmin (1.0f, 1.0f - pan), gain * juce::jmin (1.0f, 1.0f + pan) };
+
+        auto angle = (pan + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+        return { gain * juce::MathConstants<float>::sqrt2 * std::cos (angle),
+                 gain * juce::MathConstants<float>::sqrt2 * std::sin (angle) };
+    }
+
+    StereoGain lerp (StereoGain from, StereoGain to, float amount) noexcept
+    {
+        return { from.left + (to.left - from.left) * amount,
+                 from.right + (to.right - from.right) * amount };
+    }
+
+    StereoGain scale (StereoGain gain, float amount) noexcept
+    {
+        return { gain.left * amount, gain.right * amount };
+    }
+
+    void mix (const float* const* src, int numSrcChannels,
+              float* const* dst, int numDstChannels,
+              int numFrames, StereoGain from, StereoGain to) noexcept
+    {
+        if (numFrames <= 0 || numSrcChannels <= 0 || numDstChannels <= 0)
+            return;
+
+        float stepL = (to.left - from.left) / (float) numFrames;
+        float stepR = (to.right - from.right) / (float) numFrames;
+
+        if (numDstChannels == 1)
+            mixRamped<false, false> (src[0], src[0], dst[0], nullptr, numFrames, from.left, stepL, 0.0f, 0.0f);
+        else if (numSrcChannels == 1)
+            mixRamped<false, true> (src[0], src[0], dst[0], dst[1], numFrames, from.left, stepL, from.right, stepR);
+        else
+            mixRamped<true, true> (src[0], src[1], dst[0], dst[1], numFrames, from.left, stepL, from.right, stepR);
+    }
+}
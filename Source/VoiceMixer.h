@@ -0,0 +1,29 @@
+#pragma once
+#include <juce_core/juce_core.h>
+
+// Mixing kernel for sample voices. One pass adds a mono or stereo source
+// into a mono or stereo output, fanning mono out to both channels and
+// ramping each channel's gain linearly so gain and pan changes don't zipper.
+namespace VoiceMixer
+{
+    struct StereoGain
+    {
+        float left = 1.0f;
+        float right = 1.0f;
+    };
+
+    // Pan runs from -1 (left) to 1 (right). Mono sources use a constant-power
+    // law scaled to unity at centre; stereo sources are balanced, attenuating
+    // the opposite side only.
+    StereoGain panGains (float gain, float pan, bool stereoSource) noexcept;
+
+    StereoGain lerp (StereoGain from, StereoGain to, float amount) noexcept;
+    StereoGain scale (StereoGain gain, float amount) noexcept;
+
+    // Adds numFrames of src into dst; only the first two channels of either
+    // are used. The gain moves from `from` at the first frame towards `to`,
+    // reaching it at the frame after the last.
+    void mix (const float* const* src, int numSrcChannels,
+              float* const* dst, int numDstChannels,
+              int numFrames, StereoGain from, StereoGain to) noexcept;
+}
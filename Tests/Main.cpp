@@ -0,0 +1,16 @@
+#include <juce_core/juce_core.h>
+
+// Runs every registered juce::UnitTest; any failure makes the exit code
+// non-zero for ctest
+int main()
+{
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runAllTests();
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        if (runner.getResult (i)->failures > 0)
+            return 1;
+
+    return 0;
+}
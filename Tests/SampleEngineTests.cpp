@@ -0,0 +1,57 @@
+#include <juce_core/juce_core.h>
+#include "../Source/SampleEngine.h"
+
+class SampleEngineTests : public juce::UnitTest
+{
+public:
+    SampleEngineTests() : juce::UnitTest ("SampleEngine", "Beatwerk") {}
+
+    void runTest() override
+    {
+        beginTest ("Panned pads keep their level on a mono bus");
+
+        auto centred = renderOnMonoBus (0.0f);
+        expectWithinAbsoluteError (centred, 1.0f, 1.0e-4f);
+
+        for (float pan : { -1.0f, -0.5f, 0.5f, 1.0f })
+            expectWithinAbsoluteError (renderOnMonoBus (pan), centred, 1.0e-4f,
+                                       "pan " + juce::String (pan));
+    }
+
+private:
+    static constexpr double kSampleRate = 48000.0;
+    static constexpr int kBlockSize = 256;
+    static constexpr int kNote = 36;
+
+    // Peak of a full-velocity hit on a mono pad of constant 1.0, rendered
+    // into a main bus with a single channel
+    static float renderOnMonoBus (float pan)
+    {
+        SampleEngine engine;
+        engine.prepareToPlay (kSampleRate, kBlockSize);
+
+        SampleEngine::OutputLayout layout {};
+        layout[0] = { 0, 1 };
+        engine.setOutputLayout (layout);
+
+        SampleData::Ptr sample = new SampleData();
+        sample->buffer.setSize (1, kBlockSize * 4);
+        juce::FloatVectorOperations::fill (sample->buffer.getWritePointer (0), 1.0f, sample->buffer.getNumSamples());
+        sample->name = "Constant";
+        sample->lengthInFrames = sample->buffer.getNumSamples();
+        sample->fileSampleRate = kSampleRate;
+        sample->engineSampleRate = kSampleRate;
+
+        engine.publishSample (kNote, sample);
+        engine.setPadPan (kNote, pan);
+
+        juce::AudioBuffer<float> output (1, kBlockSize);
+        output.clear();
+        engine.noteOn (kNote, 1.0f);
+        engine.renderNextBlock (output, 0, kBlockSize);
+
+        return output.getMagnitude (0, 0, kBlockSize);
+    }
+};
+
+static SampleEngineTests sampleEngineTests;